@@ -0,0 +1,202 @@
+#include "board.h"
+#include "geometry.h"
+#include <QtGui>
+
+BoardWidget::BoardWidget(QWidget *parent)
+    : QWidget(parent), SR(0), SC(0), S(0), cellSize(32), current(0)
+{
+    colors[User]=Qt::darkYellow; // user input
+    colors[Given]=Qt::blue; // game values
+    colors[Conflict]=Qt::red; // conflicts
+    colors[Solved]=Qt::green; // computer solved
+
+    setFocusPolicy(Qt::StrongFocus);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setBoxSize(3,3);
+}
+
+void BoardWidget::setBoxSize (int rows, int cols) // changes geometry, clearing the board
+{
+    SR = rows;
+    SC = cols;
+    S = SR*SC;
+
+    // Keep big boards on screen by shrinking the nodes a bit
+    if (S<=9) cellSize = 32;
+    else if (S<=16) cellSize = 28;
+    else cellSize = 24;
+
+    Cell empty = { 0, User, false };
+    cells.assign(S*S,empty);
+    current = 0;
+
+    QFont f = font();
+    f.setPixelSize(cellSize*5/8);
+    setFont(f);
+
+    setFixedSize(sizeHint());
+    updateGeometry();
+    update();
+}
+
+QSize BoardWidget::sizeHint () const
+{
+    return QSize(S*cellSize+1,S*cellSize+1);
+}
+
+int BoardWidget::value (int n) const
+{
+    return cells[n].value;
+}
+
+BoardWidget::Kind BoardWidget::kind (int n) const
+{
+    return (Kind)cells[n].kind;
+}
+
+void BoardWidget::setNode (int n, int v, Kind k)
+{
+    if (cells[n].value==v && cells[n].kind==k)
+        return;
+    cells[n].value = v;
+    cells[n].kind = k;
+    update(nodeRect(n));
+}
+
+void BoardWidget::setKind (int n, Kind k)
+{
+    setNode(n,cells[n].value,k);
+}
+
+void BoardWidget::clear () // empties every node
+{
+    Cell empty = { 0, User, false };
+    cells.assign(S*S,empty);
+    update();
+}
+
+void BoardWidget::setMarked (int n, bool m)
+{
+    if (cells[n].marked==m)
+        return;
+    cells[n].marked = m;
+    update(nodeRect(n));
+}
+
+void BoardWidget::clearMarks ()
+{
+    for (int i = 0; i < S*S; ++i)
+        setMarked(i,false);
+}
+
+QRect BoardWidget::nodeRect (int n) const
+{
+    return QRect((n%S)*cellSize,(n/S)*cellSize,cellSize+1,cellSize+1);
+}
+
+void BoardWidget::moveTo (int n)
+{
+    if (n<0 || n>=S*S || n==current)
+        return;
+    update(nodeRect(current));
+    current = n;
+    update(nodeRect(current));
+}
+
+void BoardWidget::paintEvent (QPaintEvent *event)
+{
+    QPainter painter(this);
+    QRect dirty = event->rect();
+
+    // Only visit the nodes overlapping the region that needs repainting
+    int r0 = qMax(0,dirty.top()/cellSize), r1 = qMin(S-1,dirty.bottom()/cellSize);
+    int c0 = qMax(0,dirty.left()/cellSize), c1 = qMin(S-1,dirty.right()/cellSize);
+
+    for (int r = r0; r <= r1; ++r)
+    {
+        for (int c = c0; c <= c1; ++c)
+        {
+            int n = r*S+c;
+            QRect rect(c*cellSize,r*cellSize,cellSize,cellSize);
+            QColor back = cells[n].marked ? QColor(205,225,255) : QColor(Qt::white);
+            painter.fillRect(rect, (n==current && hasFocus()) ? QColor(255,255,200) : back);
+            if (cells[n].value)
+            {
+                painter.setPen(colors[cells[n].kind]);
+                painter.drawText(rect,Qt::AlignCenter,QString(QChar(symbolChar(cells[n].value))));
+            }
+        }
+    }
+
+    // Grid lines, thick ones between subgrids. Painting is clipped to the
+    // dirty region so drawing all of them is cheap.
+    for (int i = 0; i <= S; ++i)
+    {
+        bool thick = (i%SC==0);
+        painter.setPen(QPen(thick ? Qt::black : Qt::lightGray, thick ? 2 : 1));
+        painter.drawLine(i*cellSize,0,i*cellSize,S*cellSize);
+    }
+    for (int i = 0; i <= S; ++i)
+    {
+        bool thick = (i%SR==0);
+        painter.setPen(QPen(thick ? Qt::black : Qt::lightGray, thick ? 2 : 1));
+        painter.drawLine(0,i*cellSize,S*cellSize,i*cellSize);
+    }
+}
+
+void BoardWidget::keyPressEvent (QKeyEvent *event)
+{
+    switch (event->key())
+    {
+        case Qt::Key_Left:  moveTo(current%S>0 ? current-1 : current); return;
+        case Qt::Key_Right: moveTo(current%S<S-1 ? current+1 : current); return;
+        case Qt::Key_Up:    moveTo(current-S); return;
+        case Qt::Key_Down:  moveTo(current+S); return;
+        case Qt::Key_Backspace:
+        case Qt::Key_Delete:
+        case Qt::Key_Space:
+            if (cells[current].kind==Given) // game values stay as they are
+                return;
+            clearMarks();
+            setNode(current,0,User);
+            emit nodeEdited(current);
+            return;
+        default:
+            break;
+    }
+
+    // Digits 1-9 and letters for values above 9, 0 or . empties the node
+    QString text = event->text();
+    if (text.length()==1)
+    {
+        int v = symbolValue(text[0].toLatin1());
+        if (v>=0 && v<=S)
+        {
+            if (cells[current].kind==Given)
+                return;
+            clearMarks();
+            setNode(current,v,User);
+            emit nodeEdited(current);
+            return;
+        }
+    }
+    QWidget::keyPressEvent(event);
+}
+
+void BoardWidget::mousePressEvent (QMouseEvent *event)
+{
+    int r = event->y()/cellSize, c = event->x()/cellSize;
+    if (r<S && c<S)
+        moveTo(r*S+c);
+    setFocus();
+}
+
+void BoardWidget::focusInEvent (QFocusEvent *)
+{
+    update(nodeRect(current));
+}
+
+void BoardWidget::focusOutEvent (QFocusEvent *)
+{
+    update(nodeRect(current));
+}
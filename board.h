@@ -0,0 +1,69 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <QWidget>
+#include <QColor>
+#include <vector>
+
+// A sudoku board painted as a single widget. Each node is one entry in a
+// plain state array (value and kind), so boards of 16x16 and 25x25 cost
+// the same to build as 9x9 ones. Changing a node only repaints that node.
+class BoardWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // Kinds double as indices into the color table, and are what
+    // the .sud format stores in front of each value.
+    enum Kind { User=0, Given=1, Conflict=2, Solved=3, NKinds };
+
+private:
+    struct Cell
+    {
+        unsigned char value; // 0 is empty
+        unsigned char kind;
+        bool marked;         // shaded, e.g. the nodes behind a hint
+    };
+
+    std::vector<Cell> cells;
+    int SR, SC, S;   // subgrid rows, subgrid columns, values per group
+    int cellSize;
+    int current;     // node with keyboard focus
+
+    QColor colors[NKinds];
+
+public:
+    BoardWidget(QWidget *parent = 0);
+
+    void setBoxSize (int,int);
+    int boxRows () const { return SR; }
+    int boxCols () const { return SC; }
+    int size () const { return S; }
+    int nodes () const { return S*S; }
+
+    int value (int) const;
+    Kind kind (int) const;
+    void setNode (int,int,Kind);
+    void setKind (int,Kind);
+    void setMarked (int,bool);
+    void clearMarks ();
+    void clear ();
+
+    QSize sizeHint () const;
+
+signals:
+    void nodeEdited (int);
+
+protected:
+    void paintEvent (QPaintEvent*);
+    void keyPressEvent (QKeyEvent*);
+    void mousePressEvent (QMouseEvent*);
+    void focusInEvent (QFocusEvent*);
+    void focusOutEvent (QFocusEvent*);
+
+private:
+    QRect nodeRect (int) const;
+    void moveTo (int);
+};
+
+#endif // BOARD_H
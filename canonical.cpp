@@ -0,0 +1,658 @@
+#include "canonical.h"
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+// Branch and bound, one row at a time and left to right within a row,
+// dropping any branch as soon as a node compares above the best board
+// found so far. Nothing is placed before it has to be: a stack stays out
+// of the slots until a row puts a digit in it, and the columns of a
+// placed stack stay in groups that every row so far reads alike. A row
+// with new digits in a group labels its open positions in order and
+// leaves open which column takes which; the first row to tell the
+// columns apart places them, and with them the labels of those digits.
+// Empty rows always come first and, being all alike, only one is tried.
+struct Search
+{
+    struct State
+    {
+        int transpose;
+        int rows[9];
+        bool used[9];
+        signed char stackAt[3];    // stack in each slot, -1 while unplaced
+        signed char colAt[9];      // column at each position, -1 while open
+        signed char group[9];      // group of each open column, -1 once placed
+        signed char at[9];         // group of each open position
+        signed char source[9];     // by group: height of the row it labels, -1 if none
+        unsigned char label[9];    // by open position: label given there by its source
+        signed char pending[10];   // by digit: open column it stands in on a source row
+        unsigned char labels[10];
+        int next;
+        bool improved;
+    };
+
+    int b[2][9][9];     // board and its transpose, signs dropped
+    bool empty[2][9];   // rows with no digits
+    int clues[2][9];    // digits in each row
+    bool twice[2][9];   // rows with a digit more than once
+    int best[9][9];     // smallest board found so far
+    int bestRows;       // rows of best that are valid, the rest are open
+    int row[9][9];      // row being built at each height
+    bool exact;         // only boards equal to best will do, the first one ends it
+    bool found;
+    Transform *result;
+
+    bool placed (const State& s, int x) const // stack x is in some slot
+    {
+        return s.stackAt[0]==x || s.stackAt[1]==x || s.stackAt[2]==x;
+    }
+
+    // First open position of group g other than c, -1 if none
+    int first (const State& s, int g, int c) const
+    {
+        for (int i = 0; i < 9; ++i)
+            if (s.at[i]==g && i!=c)
+                return i;
+        return -1;
+    }
+
+    // Puts column x at position c, labeling the digit x has on its group's source row
+    void fix (State& s, int x, int c) const
+    {
+        int g = s.group[x];
+        if (s.source[g]>=0)
+        {
+            int v = b[s.transpose][s.rows[s.source[g]]][x];
+            s.labels[v] = s.label[c];
+            s.pending[v] = -1;
+        }
+        s.colAt[c] = x;
+        s.group[x] = -1;
+        s.at[c] = -1;
+    }
+
+    // Label of digit v, placing the column that decides it if need be
+    int labelOf (State& s, int v) const
+    {
+        if (v && !s.labels[v])
+        {
+            int y = s.pending[v];
+            if (y>=0)
+                fix(s,y,first(s,s.group[y],-1));
+            else
+                s.labels[v] = ++s.next;
+        }
+        return s.labels[v];
+    }
+
+    void record (State s)
+    {
+        // Open columns read alike on every row but their source, any order will do
+        for (int c = 0; c < 9; ++c)
+        {
+            if (s.stackAt[c/3]>=0 && s.colAt[c]<0)
+            {
+                int x = s.stackAt[c/3]*3;
+                while (s.group[x]!=s.at[c])
+                    x++;
+                fix(s,x,c);
+            }
+        }
+
+        result->transpose = s.transpose;
+        for (int i = 0; i < 9; ++i)
+            result->rows[i] = s.rows[i];
+
+        // Stacks still unplaced are empty all the way down
+        for (int k = 0, x = 0; k < 3; ++k)
+        {
+            int stack = s.stackAt[k];
+            if (stack<0)
+            {
+                while (placed(s,x))
+                    x++;
+                stack = x++;
+            }
+            for (int j = 0; j < 3; ++j)
+                result->cols[k*3+j] = s.stackAt[k]<0 ? stack*3+j : s.colAt[k*3+j];
+        }
+
+        // Digits missing from the puzzle take the leftover labels in order
+        int next = s.next;
+        result->digits[0] = 0;
+        for (int d = 1; d <= 9; ++d)
+            result->digits[d] = s.labels[d] ? s.labels[d] : ++next;
+    }
+
+    // Sets node c of row p to v, false if that makes the board bigger than best
+    bool compare (int p, int c, int v, int& cmp)
+    {
+        row[p][c] = v;
+        if (cmp==0 && v!=best[p][c])
+            cmp = v<best[p][c] ? -1 : 1;
+        return exact ? cmp==0 : cmp<=0;
+    }
+
+    // Where the first c nodes of row p stand against best, which an
+    // earlier branch may have changed since they were compared
+    int recompare (int p, int c) const
+    {
+        if (p>=bestRows)
+            return -1;
+        for (int i = 0; i < c; ++i)
+            if (row[p][i]!=best[p][i])
+                return row[p][i]<best[p][i] ? -1 : 1;
+        return 0;
+    }
+
+    // Splits the group open at position c into the columns that are empty
+    // on line and the rest, the empty ones taking the group's first positions
+    void split (State& s, int c, const int *line) const
+    {
+        int g = s.at[c], k = c/3;
+        int zeros = 0, size = 0;
+        for (int x = s.stackAt[k]*3; x < s.stackAt[k]*3+3; ++x)
+        {
+            if (s.group[x]==g)
+            {
+                size++;
+                zeros += !line[x];
+            }
+        }
+        if (zeros==0 || zeros==size)
+            return;
+
+        int pos[3] = { c, c, c }, n = 0;
+        for (int i = c; i < k*3+3; ++i)
+            if (s.at[i]==g)
+                pos[n++] = i;
+        int z = pos[0], rest = pos[zeros];
+        s.source[z] = s.source[rest] = s.source[g];
+        for (int i = 0; i < n; ++i)
+            s.at[pos[i]] = i<zeros ? z : rest;
+        for (int x = s.stackAt[k]*3; x < s.stackAt[k]*3+3; ++x)
+            if (s.group[x]==g)
+                s.group[x] = line[x] ? rest : z;
+    }
+
+    // Node c of row p, read from line q. zs counts unplaced stacks empty in
+    // q that may still fill an open slot.
+    void place (State& s, int p, int q, int c, int cmp, int zs)
+    {
+        if (found)
+            return;
+        if (c==9)
+        {
+            if (cmp<0)
+            {
+                for (int i = 0; i < 9; ++i)
+                    best[p][i] = row[p][i];
+                bestRows = p+1;
+                s.improved = true;
+            }
+            s.used[q] = true;
+            descend(s,p+1);
+            return;
+        }
+
+        const int *line = b[s.transpose][q];
+        int k = c/3;
+        if (c%3==0)
+        {
+            if (s.stackAt[k]<0)
+            {
+                if (zs>0) // an unplaced stack empty here as well, the slot stays open
+                {
+                    if (compare(p,c,0,cmp) && compare(p,c+1,0,cmp) && compare(p,c+2,0,cmp))
+                        place(s,p,q,c+3,cmp,zs-1);
+                    return;
+                }
+                for (int x = 0; x < 3; ++x)
+                {
+                    if (placed(s,x) || !(line[x*3] || line[x*3+1] || line[x*3+2]))
+                        continue;
+                    int d = recompare(p,c);
+                    if (d>0)
+                        return;
+                    State n = s;
+                    n.stackAt[k] = x;
+                    n.source[c] = -1;
+                    for (int j = 0; j < 3; ++j)
+                        n.group[x*3+j] = n.at[c+j] = c;
+                    place(n,p,q,c,d,zs);
+                }
+                return;
+            }
+        }
+
+        int col = s.colAt[c];
+        if (col<0 && s.source[s.at[c]]!=p)
+            split(s,c,line);
+        int g = s.at[c];
+        if (col>=0 || s.source[g]==p)
+        {
+            int v = col>=0 ? labelOf(s,line[col]) : s.label[c];
+            if (compare(p,c,v,cmp))
+                place(s,p,q,c+1,cmp,zs);
+            return;
+        }
+
+        // What each column of the group would put here
+        int cols[3], vals[3], n = 0, least = 10;
+        for (int x = s.stackAt[k]*3; x < s.stackAt[k]*3+3; ++x)
+        {
+            if (s.group[x]!=g)
+                continue;
+            int v = line[x], y = v ? s.pending[v] : -1;
+            if (!v)
+                vals[n] = 0;
+            else if (s.labels[v])
+                vals[n] = s.labels[v];
+            else if (y>=0)
+                vals[n] = s.label[y==x ? c : first(s,s.group[y],c)];
+            else
+                vals[n] = s.next+1;
+            least = vals[n]<least ? vals[n] : least;
+            cols[n++] = x;
+        }
+
+        if (!least)
+        {
+            if (compare(p,c,0,cmp))
+                place(s,p,q,c+1,cmp,zs);
+            return;
+        }
+
+        // Only new digits left in a group no row has labeled yet: they are
+        // alike until some later row, so this row becomes the group's source
+        if (least==s.next+1 && s.source[g]<0 && !twice[s.transpose][q])
+        {
+            s.source[g] = p;
+            for (int i = c; i < k*3+3; ++i)
+                if (s.at[i]==g)
+                    s.label[i] = ++s.next;
+            for (int i = 0; i < n; ++i)
+                s.pending[line[cols[i]]] = cols[i];
+            if (compare(p,c,s.label[c],cmp))
+                place(s,p,q,c+1,cmp,zs);
+            return;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (vals[i]!=least)
+                continue;
+            int d = recompare(p,c);
+            if (d>0)
+                return;
+            State m = s;
+            int x = cols[i], v = line[x];
+            fix(m,x,c);
+            labelOf(m,v);
+            if (compare(p,c,m.labels[v],d))
+                place(m,p,q,c+1,d,zs);
+        }
+    }
+
+    void tryRow (const State& s, int p, int q)
+    {
+        // Too many digits to open with as many zeros as best does, or
+        // when matching, not as many digits as best has
+        if (p<bestRows)
+        {
+            int zeros = 0, digits = 0;
+            while (zeros<9 && !best[p][zeros])
+                zeros++;
+            for (int i = zeros; i < 9; ++i)
+                digits += best[p][i]!=0;
+            int n = clues[s.transpose][q];
+            if (n>9-zeros || (exact && n!=digits))
+                return;
+        }
+
+        const int *line = b[s.transpose][q];
+        int zs = 0;
+        for (int x = 0; x < 3; ++x)
+            zs += !placed(s,x) && !(line[x*3] || line[x*3+1] || line[x*3+2]);
+        State n = s;
+        n.rows[p] = q;
+        place(n,p,q,0,p<bestRows ? 0 : -1,zs);
+    }
+
+    void descend (const State& s, int p)
+    {
+        if (p==9)
+        {
+            if (s.improved || exact)
+                record(s);
+            found = exact;
+            return;
+        }
+
+        // The first row of a band picks the band, the others stay inside it
+        int bands[3], nb = 0;
+        if (p%3)
+            bands[nb++] = s.rows[p-1]/3;
+        else
+            for (int band = 0; band < 3; ++band)
+                if (!s.used[band*3])
+                    bands[nb++] = band;
+
+        // An empty row beats any other, and one per band is enough; bands
+        // with nothing in them are all alike, so only the first is tried
+        const bool *e = empty[s.transpose];
+        bool anyEmpty = false, blankBand = false;
+        for (int i = 0; i < nb; ++i)
+            for (int q = bands[i]*3; q < bands[i]*3+3; ++q)
+                anyEmpty = anyEmpty || (!s.used[q] && e[q]);
+        if (anyEmpty)
+        {
+            for (int i = 0; i < nb; ++i)
+            {
+                int band = bands[i]*3;
+                if (p%3==0 && e[band] && e[band+1] && e[band+2])
+                {
+                    if (blankBand)
+                        continue;
+                    blankBand = true;
+                }
+                for (int q = band; q < band+3; ++q)
+                {
+                    if (!s.used[q] && e[q])
+                    {
+                        tryRow(s,p,q);
+                        break;
+                    }
+                }
+            }
+            return;
+        }
+
+        // Rows with fewer digits tend to read smaller, so trying them
+        // first tightens the bound sooner
+        const int *n = clues[s.transpose];
+        int order[9], count = 0;
+        for (int i = 0; i < nb; ++i)
+        {
+            for (int q = bands[i]*3; q < bands[i]*3+3; ++q)
+            {
+                if (s.used[q])
+                    continue;
+                int j = count++;
+                for (; j > 0 && n[order[j-1]]>n[q]; --j)
+                    order[j] = order[j-1];
+                order[j] = q;
+            }
+        }
+        for (int j = 0; j < count; ++j)
+            tryRow(s,p,order[j]);
+    }
+
+    void run (const int board[])
+    {
+        for (int r = 0; r < 9; ++r)
+        {
+            empty[0][r] = empty[1][r] = true;
+            for (int c = 0; c < 9; ++c)
+            {
+                int x = board[r*9+c]<0 ? -board[r*9+c] : board[r*9+c];
+                b[0][r][c] = b[1][c][r] = x;
+            }
+        }
+        for (int tr = 0; tr < 2; ++tr)
+        {
+            for (int r = 0; r < 9; ++r)
+            {
+                bool seen[10] = { false };
+                twice[tr][r] = false;
+                clues[tr][r] = 0;
+                for (int c = 0; c < 9; ++c)
+                {
+                    int x = b[tr][r][c];
+                    empty[tr][r] = empty[tr][r] && !x;
+                    clues[tr][r] += x!=0;
+                    twice[tr][r] = twice[tr][r] || (x && seen[x]);
+                    seen[x] = true;
+                }
+            }
+        }
+
+        for (int tr = 0; tr < 2; ++tr)
+        {
+            State start;
+            start.transpose = tr;
+            for (int i = 0; i < 9; ++i)
+            {
+                start.used[i] = false;
+                start.colAt[i] = start.group[i] = start.at[i] = start.source[i] = -1;
+            }
+            for (int k = 0; k < 3; ++k)
+                start.stackAt[k] = -1;
+            memset(start.pending,-1,sizeof(start.pending));
+            memset(start.labels,0,sizeof(start.labels));
+            start.next = 0;
+            start.improved = false;
+            descend(start,0);
+        }
+    }
+};
+}
+
+void canonicalize (const int board[], int canon[], Transform& t)
+{
+    Search s;
+    s.bestRows = 0;
+    s.exact = s.found = false;
+    s.result = &t;
+    s.run(board);
+
+    for (int r = 0; r < 9; ++r)
+        for (int c = 0; c < 9; ++c)
+            canon[r*9+c] = s.best[r][c];
+}
+
+bool isomorphic (const int board[], const int form[], Transform& t)
+{
+    Search s;
+    s.bestRows = 9;
+    s.exact = true;
+    s.found = false;
+    s.result = &t;
+    for (int r = 0; r < 9; ++r)
+        for (int c = 0; c < 9; ++c)
+            s.best[r][c] = form[r*9+c];
+    s.run(board);
+    return s.found;
+}
+
+void Transform::apply (const int in[], int out[]) const
+{
+    for (int r = 0; r < 9; ++r)
+    {
+        for (int c = 0; c < 9; ++c)
+        {
+            int x = transpose ? in[cols[c]*9+rows[r]] : in[rows[r]*9+cols[c]];
+            out[r*9+c] = digits[x<0 ? -x : x];
+        }
+    }
+}
+
+void Transform::invert (const int in[], int out[]) const
+{
+    int inverse[10];
+    for (int d = 0; d <= 9; ++d)
+        inverse[digits[d]] = d;
+
+    for (int r = 0; r < 9; ++r)
+    {
+        for (int c = 0; c < 9; ++c)
+        {
+            int i = transpose ? cols[c]*9+rows[r] : rows[r]*9+cols[c];
+            out[i] = inverse[in[r*9+c]];
+        }
+    }
+}
+
+///////////////// ** Solution cache ** //////////////////
+
+// What every form of the board shares: the sorted counts of each digit,
+// and of the digits in each box, row and column, the rows and columns
+// taken in either order since a transpose swaps them
+static unsigned long long digest (const int board[])
+{
+    int digits[10] = { 0 }, lines[2][9] = { { 0 } }, boxes[9] = { 0 };
+    for (int i = 0; i < 81; ++i)
+    {
+        int x = board[i]<0 ? -board[i] : board[i];
+        if (x)
+        {
+            digits[x]++;
+            lines[0][i/9]++;
+            lines[1][i%9]++;
+            boxes[i/27*3+i%9/3]++;
+        }
+    }
+    std::sort(digits+1,digits+10);
+    std::sort(lines[0],lines[0]+9);
+    std::sort(lines[1],lines[1]+9);
+    std::sort(boxes,boxes+9);
+    int first = std::lexicographical_compare(lines[1],lines[1]+9,lines[0],lines[0]+9);
+
+    unsigned long long h = 14695981039346656037ULL;
+    for (int i = 1; i <= 9; ++i)
+        h = (h^digits[i])*1099511628211ULL;
+    for (int i = 0; i < 9; ++i)
+        h = (h^boxes[i])*1099511628211ULL;
+    for (int i = 0; i < 18; ++i)
+        h = (h^lines[first^(i/9)][i%9])*1099511628211ULL;
+    return h;
+}
+
+SolutionCache::SolutionCache(size_t n)
+    : capacity(n ? n : 1), hits(0), misses(0), solver(Geometry::square(3))
+{
+}
+
+void SolutionCache::add (const Entry& e)
+{
+    entries.push_front(e);
+    index[e.puzzle] = entries.begin();
+    digests.insert(Digests::value_type(e.digest,entries.begin()));
+    if (entries.size() > capacity)
+    {
+        Entries::iterator last = --entries.end();
+        index.erase(last->puzzle);
+        std::pair<Digests::iterator,Digests::iterator> r = digests.equal_range(last->digest);
+        for (Digests::iterator it = r.first; it != r.second; ++it)
+        {
+            if (it->second==last)
+            {
+                digests.erase(it);
+                break;
+            }
+        }
+        entries.pop_back();
+    }
+}
+
+bool SolutionCache::solve (const int board[], int solution[])
+{
+    std::string key(81,0);
+    for (int i = 0; i < 81; ++i)
+        key[i] = board[i]<0 ? -board[i] : board[i];
+
+    std::unordered_map<std::string,Entries::iterator>::iterator it = index.find(key);
+    if (it!=index.end())
+    {
+        hits++;
+        entries.splice(entries.begin(),entries,it->second);
+        const Entry& e = entries.front();
+        for (int i = 0; i < 81 && !e.solution.empty(); ++i)
+            solution[i] = e.solution[i];
+        return !e.solution.empty();
+    }
+
+    Entry e;
+    e.puzzle = key;
+    e.digest = digest(board);
+
+    // Same digest: might be a form of one seen before, whose canonical
+    // form is worked out once and then matched against
+    std::pair<Digests::iterator,Digests::iterator> r = digests.equal_range(e.digest);
+    for (Digests::iterator d = r.first; d != r.second; ++d)
+    {
+        Entry& seen = *d->second;
+        int b[81], canon[81];
+        if (seen.canon.empty())
+        {
+            for (int i = 0; i < 81; ++i)
+                b[i] = seen.puzzle[i];
+            canonicalize(b,canon,seen.t);
+            seen.canon.assign(canon,canon+81);
+        }
+        for (int i = 0; i < 81; ++i)
+            canon[i] = seen.canon[i];
+        if (!isomorphic(board,canon,e.t))
+            continue;
+
+        // Its solution, carried through the canonical form onto this puzzle
+        hits++;
+        entries.splice(entries.begin(),entries,d->second);
+        e.canon = seen.canon;
+        if (!seen.solution.empty())
+        {
+            int cs[81];
+            for (int i = 0; i < 81; ++i)
+                b[i] = seen.solution[i];
+            seen.t.apply(b,cs);
+            e.t.invert(cs,solution);
+            e.solution.assign(solution,solution+81);
+        }
+        add(e);
+        return !e.solution.empty();
+    }
+
+    misses++;
+    if (solver.load(board) && solver.solve(solution))
+        e.solution.assign(solution,solution+81);
+    add(e);
+    return !e.solution.empty();
+}
+
+///////////////// ** Puzzle set ** //////////////////
+
+bool PuzzleSet::insert (const int board[])
+{
+    Entry e;
+    e.puzzle.resize(81);
+    for (int i = 0; i < 81; ++i)
+        e.puzzle[i] = board[i]<0 ? -board[i] : board[i];
+
+    unsigned long long d = digest(board);
+    typedef std::unordered_multimap<unsigned long long,Entry>::iterator Iterator;
+    std::pair<Iterator,Iterator> r = entries.equal_range(d);
+    for (Iterator it = r.first; it != r.second; ++it)
+    {
+        Entry& seen = it->second;
+        if (seen.puzzle==e.puzzle)
+            return false;
+
+        int b[81], canon[81];
+        Transform t;
+        if (seen.canon.empty())
+        {
+            for (int i = 0; i < 81; ++i)
+                b[i] = seen.puzzle[i];
+            canonicalize(b,canon,t);
+            seen.canon.assign(canon,canon+81);
+        }
+        for (int i = 0; i < 81; ++i)
+            canon[i] = seen.canon[i];
+        if (isomorphic(board,canon,t))
+            return false;
+    }
+
+    entries.insert(std::make_pair(d,e));
+    return true;
+}
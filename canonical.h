@@ -0,0 +1,98 @@
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include "solver.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Canonical forms of 9x9 puzzles.
+//
+// Two puzzles are the same puzzle in disguise when one can be turned into
+// the other by relabeling digits, swapping rows within a band, columns
+// within a stack, whole bands or stacks, and transposing. The canonical
+// form is the smallest such puzzle read in row order (empty nodes as 0),
+// so isomorphic puzzles share it.
+
+// Canonical node (r,c) is original node (rows[r],cols[c]), or
+// (cols[c],rows[r]) when transposed, with digit d relabeled digits[d].
+struct Transform
+{
+    bool transpose;
+    unsigned char rows[9];
+    unsigned char cols[9];
+    unsigned char digits[10];
+
+    void apply (const int[], int[]) const;  // original -> canonical
+    void invert (const int[], int[]) const; // canonical -> original
+};
+
+// board holds 81 values, 0 for empty, signs are ignored
+void canonicalize (const int[], int[], Transform&);
+
+// Whether board has form as its canonical form, with t taking one to the
+// other when it does. Quicker than canonicalizing board, as the search
+// drops anything that reads differently from form at once.
+bool isomorphic (const int board[], const int form[], Transform& t);
+
+// Least recently used cache of solutions for 9x9 puzzles, answering a
+// puzzle isomorphic to one seen before without a search. A puzzle seen
+// as is comes straight from a table. Otherwise a digest that no
+// transform changes (how often each digit appears, how many digits each
+// row, column and box holds) picks out the puzzles it could be a form of.
+// Those are canonicalized once and the new puzzle is only matched against
+// their forms, so a puzzle nothing collides with costs a plain solve.
+class SolutionCache
+{
+private:
+    struct Entry
+    {
+        std::string puzzle;     // as given, one byte per node
+        std::string solution;   // of puzzle, empty if none
+        unsigned long long digest;
+        std::string canon;      // canonical form, empty until needed
+        Transform t;            // puzzle -> canon, once canon is known
+    };
+    typedef std::list<Entry> Entries;
+    typedef std::unordered_multimap<unsigned long long,Entries::iterator> Digests;
+
+    Entries entries; // most recently used first
+    std::unordered_map<std::string,Entries::iterator> index;
+    Digests digests;
+    size_t capacity;
+    unsigned long long hits, misses;
+    Solver solver;
+
+    void add (const Entry&);
+
+public:
+    SolutionCache(size_t);
+
+    // Solves a 9x9 board, from the cache when possible. Returns false if
+    // the puzzle has no solution.
+    bool solve (const int[], int[]);
+
+    unsigned long long cacheHits () const { return hits; }
+    unsigned long long cacheMisses () const { return misses; }
+};
+
+// 9x9 puzzles told apart up to isomorphism. As in the cache, a puzzle is
+// only canonicalized once another with the same digest comes along.
+class PuzzleSet
+{
+private:
+    struct Entry
+    {
+        std::string puzzle; // as given, one byte per node
+        std::string canon;  // canonical form, empty until needed
+    };
+    std::unordered_multimap<unsigned long long,Entry> entries;
+
+public:
+    // Adds a 9x9 board, false if it or a form of it is in already
+    bool insert (const int[]);
+
+    size_t size () const { return entries.size(); }
+};
+
+#endif // CANONICAL_H
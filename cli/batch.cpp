@@ -0,0 +1,414 @@
+#include "batch.h"
+#include "sudoku.h"
+#include "puzzleio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////// ** Job directory ** //////////////////
+
+static std::string shard (const std::string& dir, unsigned i, const char *suffix, int pid = 0)
+{
+    char name[64];
+    if (pid)
+        snprintf(name,sizeof(name),"/%06u.%d.%s",i,pid,suffix);
+    else
+        snprintf(name,sizeof(name),"/%06u.%s",i,suffix);
+    return dir+name;
+}
+
+struct Manifest
+{
+    BatchJob job;
+    unsigned shards;
+    unsigned long long puzzles;
+};
+
+static bool writeManifest (const std::string& dir, const Manifest& m)
+{
+    std::string tmp = dir+"/manifest.tmp";
+    FILE *f = fopen(tmp.c_str(),"w");
+    if (!f)
+        return false;
+    const Geometry& g = m.job.g;
+    fprintf(f,"sudoku batch 1\ncommand %s\ngeometry %d %d %d %d\nseconds %g\nnodes %llu\nshards %u\npuzzles %llu\n",
+            m.job.count ? "count" : "solve",g.SR,g.SC,g.NSV,g.NSH,
+            m.job.limits.seconds,m.job.limits.maxNodes,m.shards,m.puzzles);
+    bool ok = fflush(f)==0 && fsync(fileno(f))==0;
+    ok = fclose(f)==0 && ok;
+    return ok && rename(tmp.c_str(),(dir+"/manifest").c_str())==0;
+}
+
+static bool readManifest (const std::string& dir, Manifest& m)
+{
+    FILE *f = fopen((dir+"/manifest").c_str(),"r");
+    if (!f)
+        return false;
+    char command[16];
+    Geometry& g = m.job.g;
+    bool ok = fscanf(f,"sudoku batch 1 command %15s geometry %d %d %d %d seconds %lf nodes %llu shards %u puzzles %llu",
+                     command,&g.SR,&g.SC,&g.NSV,&g.NSH,&m.job.limits.seconds,
+                     &m.job.limits.maxNodes,&m.shards,&m.puzzles)==9;
+    fclose(f);
+    m.job.count = strcmp(command,"count")==0;
+    return ok && (m.job.count || strcmp(command,"solve")==0);
+}
+
+// Shards merged into the output so far and the output size after them,
+// done being the answers of the last one. The record is written aside
+// and only replaces the old one after done is gone, so a crash leaves
+// either the old record and done, or the new record without done.
+static bool writeMerged (const std::string& dir, unsigned shards, unsigned long long bytes, const std::string& done)
+{
+    std::string tmp = dir+"/merged.tmp";
+    FILE *f = fopen(tmp.c_str(),"w");
+    if (!f)
+        return false;
+    fprintf(f,"%u %llu\n",shards,bytes);
+    bool ok = fflush(f)==0 && fsync(fileno(f))==0;
+    ok = fclose(f)==0 && ok;
+    return ok && unlink(done.c_str())==0 && rename(tmp.c_str(),(dir+"/merged").c_str())==0;
+}
+
+static bool readRecord (const std::string& path, unsigned& shards, unsigned long long& bytes)
+{
+    FILE *f = fopen(path.c_str(),"r");
+    if (!f)
+        return false;
+    bool ok = fscanf(f,"%u %llu",&shards,&bytes)==2;
+    fclose(f);
+    return ok;
+}
+
+static void readMerged (const std::string& dir, unsigned& shards, unsigned long long& bytes)
+{
+    // A record left aside counts once the shard it took in is gone
+    std::string tmp = dir+"/merged.tmp";
+    if (readRecord(tmp,shards,bytes) && shards && access(shard(dir,shards-1,"out").c_str(),F_OK)!=0)
+        rename(tmp.c_str(),(dir+"/merged").c_str());
+    else
+        unlink(tmp.c_str());
+
+    if (!readRecord(dir+"/merged",shards,bytes))
+        shards = bytes = 0;
+}
+
+// Whether worker pid is still there, its shards are left alone while it is
+static bool alive (int pid)
+{
+    return kill(pid,0)==0 || errno!=ESRCH;
+}
+
+// Counts waiting and running shards. The running shards of workers that
+// are gone, whether started here or by hand, and their half written
+// answers go back to waiting first.
+static void sweep (const std::string& dir, unsigned& todo, unsigned& running)
+{
+    todo = running = 0;
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    struct dirent *e;
+    while ((e = readdir(d)))
+    {
+        unsigned i;
+        int owner, n = 0;
+        char suffix[8];
+        if (sscanf(e->d_name,"%u.%d.%7s%n",&i,&owner,suffix,&n)==3 && !e->d_name[n])
+        {
+            if (alive(owner))
+            {
+                running += strcmp(suffix,"run")==0;
+                continue;
+            }
+            if (strcmp(suffix,"run")==0 && rename((dir+"/"+e->d_name).c_str(),shard(dir,i,"todo").c_str())==0)
+                todo++;
+            else if (strcmp(suffix,"tmp")==0)
+                unlink((dir+"/"+e->d_name).c_str());
+        }
+        else if (sscanf(e->d_name,"%u.%7s%n",&i,suffix,&n)==2 && !e->d_name[n] && strcmp(suffix,"todo")==0)
+        {
+            todo++;
+        }
+    }
+    closedir(d);
+}
+
+static bool split (const std::string& dir, const BatchJob& job, const char *in, Manifest& m)
+{
+    PuzzleReader reader(job.g);
+    if (!reader.open(in))
+        return false;
+
+    int N = job.g.N();
+    std::vector<int> board(N);
+    m.job = job;
+    m.shards = 0;
+    m.puzzles = 0;
+
+    bool more = reader.next(&board[0]);
+    while (more)
+    {
+        std::string tmp = shard(dir,m.shards,"tmp",getpid());
+        PuzzleWriter writer;
+        if (!writer.open(tmp.c_str()))
+            return false;
+        for (unsigned k = 0; k < job.shardSize && more; ++k)
+        {
+            writer.write(&board[0],N);
+            m.puzzles++;
+            more = reader.next(&board[0]);
+        }
+        if (!writer.close() || rename(tmp.c_str(),shard(dir,m.shards,"todo").c_str())!=0)
+            return false;
+        m.shards++;
+    }
+
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    return writeManifest(dir,m);
+}
+
+///////////////// ** Worker ** //////////////////
+
+static bool answerShard (const Manifest& m, const std::string& in, const std::string& out)
+{
+    const Geometry& g = m.job.g;
+    PuzzleReader reader(g);
+    PuzzleWriter writer;
+    if (!reader.open(in.c_str()) || !writer.open(out.c_str()))
+        return false;
+
+    int N = g.N(), C = g.C();
+    std::vector<int> board(N), solution(N);
+    while (reader.next(&board[0]))
+    {
+        Sudoku sud(g.SR,g.SC,g.NSV,g.NSH,&board[0]);
+        char line[64];
+        int length;
+        if (m.job.count)
+        {
+            unsigned long long n;
+            if (sud.nSolutions(m.job.limits,n)==GaveUp)
+                length = snprintf(line,sizeof(line),"# gave up after %llu\n",n);
+            else
+                length = snprintf(line,sizeof(line),"%llu\n",n);
+            writer.write(line,length);
+            continue;
+        }
+
+        sud.findBadNodes();
+        SearchStatus status = sud.Solve(m.job.limits);
+        if (status==Found)
+        {
+            for (int i = 0; i < N; ++i)
+                solution[i] = *sud.GetNode(i/C,i%C).begin();
+            writer.write(&solution[0],N);
+            continue;
+        }
+        length = snprintf(line,sizeof(line),status==GaveUp ? "# gave up\n" : "# no solution\n");
+        writer.write(line,length);
+    }
+
+    // The answers must be on disk before the rename says they are done
+    if (!writer.flush())
+        return false;
+    int fd = ::open(out.c_str(),O_RDONLY);
+    bool synced = fd>=0 && fsync(fd)==0;
+    if (fd>=0)
+        ::close(fd);
+    return writer.close() && synced;
+}
+
+int runWorker (const char *path)
+{
+    std::string dir(path);
+    Manifest m;
+    if (!readManifest(dir,m))
+    {
+        fprintf(stderr,"sudokucli: %s is not a batch directory\n",path);
+        return 1;
+    }
+
+    int pid = getpid();
+    for (unsigned i = 0; i < m.shards; ++i)
+    {
+        std::string todo = shard(dir,i,"todo"), run = shard(dir,i,"run",pid);
+        if (rename(todo.c_str(),run.c_str())!=0) // taken or done already
+            continue;
+
+        std::string tmp = shard(dir,i,"tmp",pid);
+        if (!answerShard(m,run,tmp) || rename(tmp.c_str(),shard(dir,i,"out").c_str())!=0)
+        {
+            perror("sudokucli");
+            rename(run.c_str(),todo.c_str());
+            return 1;
+        }
+        unlink(run.c_str());
+    }
+    return 0;
+}
+
+///////////////// ** Coordinator ** //////////////////
+
+static pid_t spawn (const char *self, const std::string& dir)
+{
+    pid_t pid = fork();
+    if (pid==0)
+    {
+        prctl(PR_SET_PDEATHSIG,SIGTERM); // workers go when the coordinator does
+        execlp(self,self,"work",dir.c_str(),(char*)0);
+        perror("sudokucli: worker");
+        _exit(127);
+    }
+    return pid;
+}
+
+// Appends shard i to the output, false if it is not there
+static bool append (int out, const std::string& path, unsigned long long& bytes)
+{
+    int fd = ::open(path.c_str(),O_RDONLY);
+    if (fd<0)
+        return false;
+    char buf[1<<16];
+    ssize_t n;
+    while ((n = read(fd,buf,sizeof(buf))) > 0)
+    {
+        for (ssize_t w = 0, k; w < n; w += k)
+        {
+            k = write(out,buf+w,n-w);
+            if (k<=0)
+            {
+                ::close(fd);
+                return false;
+            }
+        }
+        bytes += n;
+    }
+    ::close(fd);
+    return n==0;
+}
+
+int runBatch (const char *self, const BatchJob& job, const char *in, const char *out)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    std::string dir = std::string(out)+".shards";
+    if (mkdir(dir.c_str(),0777)!=0 && errno!=EEXIST)
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    Manifest m;
+    bool resumed = readManifest(dir,m);
+    if (resumed && (m.job.g!=job.g || m.job.count!=job.count))
+    {
+        fprintf(stderr,"sudokucli: %s holds a different job\n",dir.c_str());
+        return 1;
+    }
+    if (!resumed && !split(dir,job,in,m))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    // Cut the output back to what was merged, and requeue what workers that
+    // are gone left running
+    unsigned merged;
+    unsigned long long bytes;
+    readMerged(dir,merged,bytes);
+    int fd = ::open(out,O_WRONLY|O_CREAT,0666);
+    if (fd<0 || ftruncate(fd,bytes)!=0 || lseek(fd,bytes,SEEK_SET)<0)
+    {
+        perror("sudokucli");
+        return 1;
+    }
+    unsigned todo, running;
+    sweep(dir,todo,running);
+    if (resumed)
+        fprintf(stderr,"sudokucli: resuming, %u of %u shards done\n",m.shards-todo,m.shards);
+
+    int workers = job.workers>0 ? job.workers : std::thread::hardware_concurrency();
+    if (workers<1)
+        workers = 1;
+    std::vector<pid_t> live;
+    unsigned starts = 0, failures = 0;
+
+    while (merged < m.shards)
+    {
+        // Take in every finished shard that is next in line
+        std::string done;
+        while (merged < m.shards && access((done = shard(dir,merged,"out")).c_str(),F_OK)==0)
+        {
+            if (!append(fd,done,bytes) || fsync(fd)!=0 || !writeMerged(dir,merged+1,bytes,done))
+            {
+                perror("sudokucli");
+                return 1;
+            }
+            merged++;
+        }
+        if (merged==m.shards)
+            break;
+
+        // Reap workers, the sweep puts back what the ones that died left
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1,&status,WNOHANG)) > 0)
+        {
+            for (size_t i = 0; i < live.size(); ++i)
+                if (live[i]==pid)
+                    live.erase(live.begin()+i);
+            if (!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+                failures++;
+        }
+
+        sweep(dir,todo,running);
+        while ((int)live.size() < workers && live.size() < todo && starts < workers+m.shards)
+        {
+            pid = spawn(self,dir);
+            if (pid<0)
+                break;
+            live.push_back(pid);
+            starts++;
+        }
+        if (live.empty() && !running && access(shard(dir,merged,"out").c_str(),F_OK)!=0)
+        {
+            fprintf(stderr,"sudokucli: shard %u failed, run again to retry\n",merged);
+            return 1;
+        }
+        usleep(10000);
+    }
+
+    for (size_t i = 0; i < live.size(); ++i)
+        waitpid(live[i],0,0);
+    if (::close(fd)!=0)
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    unlink((dir+"/manifest").c_str());
+    unlink((dir+"/merged").c_str());
+    rmdir(dir.c_str());
+
+    double seconds = std::chrono::duration<double>(Clock::now()-start).count();
+    fprintf(stderr,"sudokucli: %llu puzzles in %u shards, %u worker starts, %.2f s\n",
+            m.puzzles,m.shards,starts,seconds);
+    if (failures)
+        fprintf(stderr,"sudokucli: %u workers failed and their shards were redone\n",failures);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "geometry.h"
+#include "solver.h"
+
+// Multi-process runs of solve or count over big puzzle files. The
+// coordinator splits the input into shards in a directory next to the
+// output (out.shards) and starts worker processes, which claim shards
+// by renaming them and write each result next to it:
+//
+//   000012.todo          puzzles waiting
+//   000012.<pid>.run     taken by worker pid
+//   000012.out           answers, one line per puzzle
+//
+// Finished shards are appended to the output in order as soon as all
+// shards before them are done. Everything moves by rename, so after a
+// crash running the same command again picks up where it stopped:
+// shards left running by workers that are gone go back to waiting,
+// those of workers still at it are left to them, and the output is cut
+// back to the last shard recorded as merged.
+struct BatchJob
+{
+    Geometry g;
+    bool count;       // count solutions instead of solving
+    Limits limits;
+    int workers;      // processes, 0 for one per core
+    unsigned shardSize;
+};
+
+// Runs the whole job, self is the path of this program for the workers
+int runBatch (const char *self, const BatchJob&, const char *in, const char *out);
+
+// One worker, taking shards from dir until none are left. More workers
+// can be started by hand with sudokucli work dir.
+int runWorker (const char *dir);
+
+#endif // BATCH_H
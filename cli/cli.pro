@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Headless solver for puzzle files
+#
+#-------------------------------------------------
+
+CONFIG   += console
+CONFIG   -= qt app_bundle
+
+TARGET = sudokucli
+TEMPLATE = app
+
+include(../core.pri)
+
+SOURCES += main.cpp \
+    batch.cpp \
+    pipeline.cpp
+
+HEADERS += batch.h \
+    pipeline.h \
+    queue.h
@@ -0,0 +1,756 @@
+#include "sudoku.h"
+#include "batch.h"
+#include "canonical.h"
+#include "counter.h"
+#include "geometry.h"
+#include "grade.h"
+#include "graph.h"
+#include "pipeline.h"
+#include "puzzledb.h"
+#include "puzzleio.h"
+#include "protocol.h"
+#include "solver.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void usage ()
+{
+    fprintf(stderr,
+            "usage: sudokucli [options] command [args]\n"
+            "\n"
+            "  solve [in] [out]      solve text puzzles, one solution line each\n"
+            "  count [in] [out]      count the solutions of each puzzle\n"
+            "  grade [in] [out]      rate each puzzle: level, score, search nodes, hardest rule\n"
+            "  pack in out.sdb       store text puzzles in a puzzle pack\n"
+            "  unpack in.sdb [out]   write the puzzles of a pack as text\n"
+            "  stats                 print the counters of sudokud (needs -S)\n"
+            "  batch solve|count in out\n"
+            "                        solve or count with worker processes, resumable\n"
+            "  work dir              take shards of a batch in dir (out.shards)\n"
+            "  pipeline count [out]  make count new puzzles, text or a pack if out ends in .sdb\n"
+            "\n"
+            "  -n size   subgrid size, 3 for 9x9 (default), 4 for 16x16...\n"
+            "  -t count  count, pipeline: threads to use, all cores by default\n"
+            "  -d secs   solve, count, pipeline: give up on a puzzle after this long\n"
+            "  -m count  solve, count, pipeline: give up on a puzzle after this many choices\n"
+            "  -c count  solve: cache this many solutions by canonical form (9x9)\n"
+            "  -u        pack: drop puzzles isomorphic to earlier ones (9x9)\n"
+            "  -L level  pipeline: only easy, medium, hard, expert or extreme puzzles\n"
+            "  -S path   solve, count: send the puzzles to sudokud on this socket\n"
+            "  -j count  batch: worker processes, one per core by default\n"
+            "  -k count  batch: puzzles per shard, 1000 by default\n"
+            "  -C path   count: count the first puzzle only, saving where it got to in\n"
+            "            path, and carry on from there if path exists\n"
+            "  -i secs   count: save to the -C file this often, 60 by default\n"
+            "  -r map    solve, count: jigsaw regions instead of subgrids, one symbol\n"
+            "            per node from 0 to S-1 (0-9 then A-Z), row by row\n"
+            "  -x        solve, count: the long diagonals hold every value too\n"
+            "  -w        solve, count: windoku, four more subgrid sized windows (9x9)\n"
+            "  in and out default to standard input and output.\n");
+}
+
+struct Options
+{
+    Geometry g;
+    size_t cache;
+    bool unique;
+    int threads;
+    Limits limits;
+    const char *socket;
+    int jobs;
+    unsigned shardSize;
+    const char *checkpoint;
+    double interval;
+    int level;
+    const ConstraintGraph *graph; // units of the puzzles, rows, columns and subgrids unless a variant
+};
+
+///////////////// ** sudokud client ** //////////////////
+
+struct Reply
+{
+    int status;
+    unsigned long long value;
+    std::string payload;
+};
+
+// Requests are buffered and sent together, so the daemon gets them in
+// batches, and answers are matched to requests by id.
+class Remote
+{
+private:
+    int fd;
+    std::string out, in;
+
+public:
+    Remote() : fd(-1) {}
+    ~Remote() { if (fd>=0) close(fd); }
+
+    bool open (const char *path)
+    {
+        struct sockaddr_un addr;
+        memset(&addr,0,sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path,path,sizeof(addr.sun_path)-1);
+        fd = socket(AF_UNIX,SOCK_STREAM,0);
+        return fd>=0 && connect(fd,(struct sockaddr*)&addr,sizeof(addr))==0;
+    }
+
+    void send (unsigned id, Protocol::Op op, const Geometry& g, unsigned arg,
+               unsigned timeoutMs, const int board[], int N)
+    {
+        unsigned char h[Protocol::RequestHeader];
+        Protocol::request(h,id,op,g,arg,timeoutMs,board ? N : 0);
+        out.append((const char*)h,sizeof(h));
+        for (int i = 0; i < N && board; ++i)
+            out += (char)(board[i]<0 ? -board[i] : board[i]);
+    }
+
+    bool flush ()
+    {
+        size_t sent = 0;
+        while (sent < out.size())
+        {
+            ssize_t n = write(fd,out.data()+sent,out.size()-sent);
+            if (n<=0)
+                return false;
+            sent += n;
+        }
+        out.clear();
+        return true;
+    }
+
+    bool receive (unsigned& id, Reply& r) // waits for the next answer
+    {
+        while (1)
+        {
+            if (in.size() >= Protocol::ResponseHeader)
+            {
+                const unsigned char *h = (const unsigned char*)in.data();
+                size_t length = 4+Protocol::get32(h);
+                if (length < Protocol::ResponseHeader)
+                    return false;
+                if (in.size() >= length)
+                {
+                    id = Protocol::get32(h+4);
+                    r.status = h[9];
+                    r.value = Protocol::get64(h+12);
+                    r.payload.assign(in,Protocol::ResponseHeader,length-Protocol::ResponseHeader);
+                    in.erase(0,length);
+                    return true;
+                }
+            }
+            char buf[1<<16];
+            ssize_t n = read(fd,buf,sizeof(buf));
+            if (n<=0)
+                return false;
+            in.append(buf,n);
+        }
+    }
+};
+
+// solve or count through sudokud, with up to Window puzzles in flight
+static int remote (const Options& o, Protocol::Op op, const char *in, const char *out)
+{
+    enum { Window = 256 };
+
+    const Geometry& g = o.g;
+    PuzzleReader reader(g);
+    PuzzleWriter writer;
+    Remote daemon;
+    if (!reader.open(in) || !writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+    if (!daemon.open(o.socket))
+    {
+        fprintf(stderr,"sudokucli: cannot reach sudokud on %s\n",o.socket);
+        return 1;
+    }
+
+    int N = g.N();
+    unsigned timeoutMs = o.limits.seconds>0 ? std::max(1.0,o.limits.seconds*1000) : 0;
+    std::vector<int> board(N);
+    std::unordered_map<unsigned,Reply> answers;
+    unsigned sent = 0, written = 0;
+    unsigned long long gaveUp = 0;
+    bool more = true;
+
+    while (more || written < sent)
+    {
+        // Queue up a window of puzzles, then wait for the oldest answer
+        while (more && sent-written < Window)
+        {
+            more = reader.next(&board[0]);
+            if (more)
+                daemon.send(sent++,op,g,0,timeoutMs,&board[0],N);
+        }
+        if (written==sent)
+            break;
+
+        unsigned id;
+        Reply r;
+        if (!daemon.flush() || !daemon.receive(id,r))
+        {
+            fprintf(stderr,"sudokucli: lost sudokud\n");
+            return 1;
+        }
+        answers[id] = r;
+
+        std::unordered_map<unsigned,Reply>::iterator it;
+        while ((it = answers.find(written)) != answers.end())
+        {
+            const Reply& a = it->second;
+            char line[64];
+            int length = 0;
+            if (a.status==Protocol::Ok && op==Protocol::Solve && (int)a.payload.size()==N)
+            {
+                for (int i = 0; i < N; ++i)
+                    board[i] = (unsigned char)a.payload[i];
+                writer.write(&board[0],N);
+            }
+            else if (a.status==Protocol::Ok && op==Protocol::Count)
+                length = snprintf(line,sizeof(line),"%llu\n",a.value);
+            else if (a.status==Protocol::GaveUp && op==Protocol::Count)
+                length = snprintf(line,sizeof(line),"# gave up after %llu\n",a.value);
+            else if (a.status==Protocol::GaveUp)
+                length = snprintf(line,sizeof(line),"# gave up\n");
+            else if (a.status==Protocol::NotFound)
+                length = snprintf(line,sizeof(line),"# no solution\n");
+            else
+                length = snprintf(line,sizeof(line),"# bad request\n");
+            if (length)
+                writer.write(line,length);
+            if (a.status==Protocol::GaveUp)
+                gaveUp++;
+            answers.erase(it);
+            written++;
+        }
+    }
+
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    if (gaveUp)
+        fprintf(stderr,"sudokucli: gave up on %llu puzzles\n",gaveUp);
+    return writer.close() ? 0 : 1;
+}
+
+static int stats (const Options& o)
+{
+    Remote daemon;
+    if (!o.socket || !daemon.open(o.socket))
+    {
+        fprintf(stderr,"sudokucli: cannot reach sudokud on %s\n",o.socket ? o.socket : "(no -S)");
+        return 1;
+    }
+
+    unsigned id;
+    Reply r;
+    daemon.send(0,Protocol::Stats,o.g,0,0,0,0);
+    if (!daemon.flush() || !daemon.receive(id,r))
+    {
+        fprintf(stderr,"sudokucli: lost sudokud\n");
+        return 1;
+    }
+    fwrite(r.payload.data(),1,r.payload.size(),stdout);
+    return 0;
+}
+
+///////////////// ** Local commands ** //////////////////
+
+static int solve (const Options& o, const char *in, const char *out)
+{
+    const Geometry& g = o.g;
+    PuzzleReader reader(g);
+    PuzzleWriter writer;
+    if (!reader.open(in) || !writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    SolutionCache *cache = o.cache ? new SolutionCache(o.cache) : 0;
+
+    int N = g.N(), C = g.C();
+    std::vector<int> board(N), solution(N);
+    unsigned long long gaveUp = 0;
+    while (reader.next(&board[0]))
+    {
+        SearchStatus status;
+        if (cache)
+        {
+            status = cache->solve(&board[0],&solution[0]) ? Found : NotFound;
+        }
+        else
+        {
+            Sudoku sud(*o.graph,&board[0]);
+            sud.findBadNodes();
+            status = sud.Solve(o.limits);
+            for (int i = 0; i < N && status==Found; ++i)
+                solution[i] = *sud.GetNode(i/C,i%C).begin();
+        }
+
+        if (status==Found)
+        {
+            writer.write(&solution[0],N);
+        }
+        else if (status==GaveUp)
+        {
+            static const char none[] = "# gave up\n";
+            writer.write(none,sizeof(none)-1);
+            gaveUp++;
+        }
+        else
+        {
+            static const char none[] = "# no solution\n";
+            writer.write(none,sizeof(none)-1);
+        }
+    }
+
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    if (cache)
+    {
+        fprintf(stderr,"sudokucli: %llu cache hits, %llu misses\n",cache->cacheHits(),cache->cacheMisses());
+        delete cache;
+    }
+    if (gaveUp)
+        fprintf(stderr,"sudokucli: gave up on %llu puzzles\n",gaveUp);
+    return writer.close() ? 0 : 1;
+}
+
+static int count (const Options& o, const char *in, const char *out)
+{
+    const Geometry& g = o.g;
+    PuzzleReader reader(g);
+    PuzzleWriter writer;
+    if (!reader.open(in) || !writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    std::vector<int> board(g.N());
+    unsigned long long gaveUp = 0;
+    while (reader.next(&board[0]))
+    {
+        SearchStats stats;
+        unsigned long long n = parallelCount(*o.graph,&board[0],o.threads,o.limits,&stats);
+
+        char line[64];
+        int length;
+        if (stats.gaveUp) // what was found so far, as a comment
+        {
+            length = snprintf(line,sizeof(line),"# gave up after %llu\n",n);
+            gaveUp++;
+        }
+        else
+        {
+            length = snprintf(line,sizeof(line),"%llu\n",n);
+        }
+        writer.write(line,length);
+    }
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    if (gaveUp)
+        fprintf(stderr,"sudokucli: gave up on %llu puzzles\n",gaveUp);
+    return writer.close() ? 0 : 1;
+}
+
+///////////////// ** Long counts ** //////////////////
+
+static CancelToken interrupted;
+
+static void interrupt (int)
+{
+    interrupted.cancel();
+}
+
+// One count that may take hours, saved to the checkpoint every interval
+// and on ^C, so it can be stopped and carried on from where it got to
+static int longCount (const Options& o, const char *in, const char *out)
+{
+    CountJob job(o.g);
+    PuzzleWriter writer;
+    if (access(o.checkpoint,F_OK)==0)
+    {
+        if (!job.load(o.checkpoint))
+        {
+            fprintf(stderr,"sudokucli: %s is not a %dx%d count checkpoint\n",o.checkpoint,o.g.S(),o.g.S());
+            return 1;
+        }
+        fprintf(stderr,"sudokucli: carrying on from %s, %llu so far\n",o.checkpoint,job.count());
+    }
+    else
+    {
+        PuzzleReader reader(o.g);
+        std::vector<int> board(o.g.N());
+        if (!reader.open(in))
+        {
+            perror("sudokucli");
+            return 1;
+        }
+        if (!reader.next(&board[0]))
+        {
+            fprintf(stderr,"sudokucli: no puzzle to count\n");
+            return 1;
+        }
+        job.start(&board[0]);
+    }
+    if (!writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa,0,sizeof(sa));
+    sa.sa_handler = interrupt;
+    sigaction(SIGINT,&sa,0);
+    sigaction(SIGTERM,&sa,0);
+
+    Limits limits = o.limits;
+    limits.token = &interrupted;
+    SearchStatus status = job.run(o.threads,limits,o.interval,o.checkpoint);
+
+    char line[64];
+    int length;
+    if (status==GaveUp)
+    {
+        length = snprintf(line,sizeof(line),"# gave up after %llu\n",job.count());
+        fprintf(stderr,"sudokucli: stopped after %.0f seconds, run again with -C %s to carry on\n",
+                job.stats().seconds,o.checkpoint);
+    }
+    else
+    {
+        length = snprintf(line,sizeof(line),"%llu\n",job.count());
+        unlink(o.checkpoint);
+    }
+    writer.write(line,length);
+    return writer.close() ? 0 : 1;
+}
+
+static int grade (const Options& o, const char *in, const char *out)
+{
+    const Geometry& g = o.g;
+    PuzzleReader reader(g);
+    PuzzleWriter writer;
+    if (!reader.open(in) || !writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    Grader grader(g);
+    std::vector<int> board(g.N());
+    unsigned long long levels[Grade::NLevels] = { 0 }, invalid = 0;
+    while (reader.next(&board[0]))
+    {
+        Grade r;
+        SearchStatus status = grader.grade(&board[0],r,o.limits);
+        char line[128];
+        int length;
+        if (status==Found)
+        {
+            length = snprintf(line,sizeof(line),"%s %d %llu %s\n",levelName(r.level),r.score,r.nodes,ruleName(r.hardest));
+            levels[r.level]++;
+        }
+        else
+        {
+            length = snprintf(line,sizeof(line),status==GaveUp ? "# gave up\n" : r.solutions ? "# several solutions\n" : "# no solution\n");
+            invalid++;
+        }
+        writer.write(line,length);
+    }
+
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    for (int l = 0; l < Grade::NLevels; ++l)
+        fprintf(stderr,"%s%s %llu",l ? ", " : "sudokucli: ",levelName((Grade::Level)l),levels[l]);
+    fprintf(stderr,", not graded %llu\n",invalid);
+    return writer.close() ? 0 : 1;
+}
+
+static int pack (const Options& o, const char *in, const char *out)
+{
+    const Geometry& g = o.g;
+    PuzzleReader reader(g);
+    PuzzleDbWriter writer;
+    if (!reader.open(in) || !writer.open(out,g))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    // The puzzles packed so far, up to isomorphism
+    PuzzleSet seen;
+    unsigned long long duplicates = 0;
+
+    std::vector<int> board(g.N());
+    while (reader.next(&board[0]))
+    {
+        if (o.unique && !seen.insert(&board[0]))
+        {
+            duplicates++;
+            continue;
+        }
+        if (!writer.append(&board[0]))
+        {
+            perror("sudokucli");
+            writer.close();
+            return 1;
+        }
+    }
+
+    if (reader.skippedLines())
+        fprintf(stderr,"sudokucli: skipped %llu unreadable lines\n",reader.skippedLines());
+    if (duplicates)
+        fprintf(stderr,"sudokucli: dropped %llu duplicates\n",duplicates);
+    fprintf(stderr,"sudokucli: packed %llu puzzles\n",writer.size());
+    return writer.close() ? 0 : 1;
+}
+
+static int unpack (const char *in, const char *out)
+{
+    PuzzleDb db;
+    PuzzleWriter writer;
+    if (!db.open(in))
+    {
+        fprintf(stderr,"sudokucli: %s is not a puzzle pack\n",in);
+        return 1;
+    }
+    if (!writer.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    int N = db.geometry().N();
+    std::vector<int> board(N);
+    for (unsigned long long i = 0; i < db.size(); ++i)
+    {
+        if (!db.get(i,&board[0]))
+        {
+            fprintf(stderr,"sudokucli: %s is damaged at puzzle %llu\n",in,i);
+            writer.close();
+            return 1;
+        }
+        writer.write(&board[0],N);
+    }
+    return writer.close() ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    Options o;
+    o.cache = 0;
+    o.unique = false;
+    o.threads = 0;
+    o.socket = 0;
+    o.jobs = 0;
+    o.shardSize = 1000;
+    o.checkpoint = 0;
+    o.interval = 60;
+    o.level = -1;
+    const char *regions = 0;
+    bool diagonals = false, windows = false;
+    int a = 1;
+
+    while (a < argc && argv[a][0]=='-' && argv[a][1])
+    {
+        if (strcmp(argv[a],"-n")==0 && a+1 < argc)
+        {
+            int n = atoi(argv[a+1]);
+            if (n<2 || n>5)
+            {
+                fprintf(stderr,"sudokucli: size must be between 2 and 5\n");
+                return 1;
+            }
+            o.g = Geometry::square(n);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-c")==0 && a+1 < argc)
+        {
+            o.cache = atol(argv[a+1]);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-t")==0 && a+1 < argc)
+        {
+            o.threads = atoi(argv[a+1]);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-d")==0 && a+1 < argc)
+        {
+            o.limits.seconds = atof(argv[a+1]);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-m")==0 && a+1 < argc)
+        {
+            o.limits.maxNodes = strtoull(argv[a+1],0,10);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-j")==0 && a+1 < argc)
+        {
+            o.jobs = atoi(argv[a+1]);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-k")==0 && a+1 < argc)
+        {
+            o.shardSize = std::max(1,atoi(argv[a+1]));
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-C")==0 && a+1 < argc)
+        {
+            o.checkpoint = argv[a+1];
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-i")==0 && a+1 < argc)
+        {
+            o.interval = atof(argv[a+1]);
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-S")==0 && a+1 < argc)
+        {
+            o.socket = argv[a+1];
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-L")==0 && a+1 < argc)
+        {
+            for (int l = 0; l < Grade::NLevels; ++l)
+                if (strcmp(argv[a+1],levelName((Grade::Level)l))==0)
+                    o.level = l;
+            if (o.level<0)
+            {
+                usage();
+                return 1;
+            }
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-r")==0 && a+1 < argc)
+        {
+            regions = argv[a+1];
+            a += 2;
+        }
+        else if (strcmp(argv[a],"-x")==0)
+        {
+            diagonals = true;
+            a++;
+        }
+        else if (strcmp(argv[a],"-w")==0)
+        {
+            windows = true;
+            a++;
+        }
+        else if (strcmp(argv[a],"-u")==0)
+        {
+            o.unique = true;
+            a++;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (a >= argc)
+    {
+        usage();
+        return 1;
+    }
+
+    if ((o.cache || o.unique) && o.g!=Geometry::square(3))
+    {
+        fprintf(stderr,"sudokucli: canonical forms are only known for 9x9 boards\n");
+        return 1;
+    }
+
+    ConstraintGraph graph(o.g);
+    if (regions)
+    {
+        std::vector<int> map(o.g.N(),-1);
+        for (int i = 0; i < o.g.N() && regions[i]; ++i)
+            map[i] = symbolValue(regions[i]);
+        if ((int)strlen(regions)!=o.g.N() || !graph.setRegions(&map[0]))
+        {
+            fprintf(stderr,"sudokucli: the region map needs %d symbols, each of 0 to %d used %d times\n",
+                    o.g.N(),o.g.S()-1,o.g.S());
+            return 1;
+        }
+    }
+    if (diagonals && !graph.addDiagonals())
+    {
+        fprintf(stderr,"sudokucli: diagonals need a board of %d by %d\n",o.g.S(),o.g.S());
+        return 1;
+    }
+    if (windows && !graph.addWindows())
+    {
+        fprintf(stderr,"sudokucli: the board has no room for windows\n");
+        return 1;
+    }
+    o.graph = &graph;
+
+    srand(time(NULL));
+
+    const char *command = argv[a++];
+    if (!graph.classic() && ((strcmp(command,"solve")!=0 && strcmp(command,"count")!=0)
+                             || o.cache || o.socket || o.checkpoint))
+    {
+        fprintf(stderr,"sudokucli: variants can only be solved and counted here, without -c, -S or -C\n");
+        return 1;
+    }
+    const char *arg1 = a < argc ? argv[a] : "-";
+    const char *arg2 = a+1 < argc ? argv[a+1] : "-";
+
+    if (strcmp(command,"solve")==0)
+        return o.socket ? remote(o,Protocol::Solve,arg1,arg2) : solve(o,arg1,arg2);
+    if (strcmp(command,"count")==0 && o.checkpoint)
+        return longCount(o,arg1,arg2);
+    if (strcmp(command,"count")==0)
+        return o.socket ? remote(o,Protocol::Count,arg1,arg2) : count(o,arg1,arg2);
+    if (strcmp(command,"grade")==0)
+        return grade(o,arg1,arg2);
+    if (strcmp(command,"stats")==0)
+        return stats(o);
+    if (strcmp(command,"batch")==0 && a+2 < argc && strcmp(argv[a+2],"-")!=0
+        && (strcmp(arg1,"solve")==0 || strcmp(arg1,"count")==0))
+    {
+        BatchJob job;
+        job.g = o.g;
+        job.count = strcmp(arg1,"count")==0;
+        job.limits = o.limits;
+        job.workers = o.jobs;
+        job.shardSize = o.shardSize;
+        return runBatch(argv[0],job,arg2,argv[a+2]);
+    }
+    if (strcmp(command,"pipeline")==0 && a < argc && strtoull(arg1,0,10)>0)
+    {
+        PipelineJob job;
+        job.g = o.g;
+        job.count = strtoull(arg1,0,10);
+        job.level = o.level;
+        job.threads = o.threads;
+        job.limits = o.limits;
+        return runPipeline(job,arg2);
+    }
+    if (strcmp(command,"work")==0 && a < argc)
+        return runWorker(arg1);
+    if (strcmp(command,"pack")==0 && a+1 < argc)
+        return pack(o,arg1,arg2);
+    if (strcmp(command,"unpack")==0 && a < argc)
+        return unpack(arg1,arg2);
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,304 @@
+#include "pipeline.h"
+#include "queue.h"
+#include "canonical.h"
+#include "grade.h"
+#include "puzzledb.h"
+#include "puzzleio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Puzzle
+{
+    std::vector<int> board;
+    Grade grade;
+};
+
+typedef BoundedQueue<Puzzle> Queue;
+
+// What a stage did, summed over its threads
+struct Stage
+{
+    const char *name;
+    int threads;
+    std::atomic<int> running; // threads still going, the next stage drains and stops at 0
+    std::atomic<unsigned long long> done, dropped;
+    std::atomic<long long> starved, blocked; // microseconds waiting for input, for room
+
+    Stage(const char *n, int t)
+        : name(n), threads(t), running(t), done(0), dropped(0), starved(0), blocked(0) {}
+};
+
+// Grids in a row that may come out easier than the level asked for
+// before the run gives up on it
+enum { MaxMisses = 1000 };
+
+struct Pipeline
+{
+    const PipelineJob& job;
+    std::atomic<bool> finished, gaveUp;
+    std::atomic<int> misses;
+    Queue grids, puzzles, graded, fresh; // in front of clues, grade, dedupe, write
+
+    Pipeline(const PipelineJob& j, size_t depth)
+        : job(j), finished(false), gaveUp(false), misses(0),
+          grids(depth), puzzles(depth), graded(depth), fresh(depth) {}
+};
+
+static long long since (Clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now()-t).count();
+}
+
+static void backOff (int& tries) // spin a little, then sleep longer and longer
+{
+    if (++tries < 16)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(tries < 64 ? 50 : 500));
+}
+
+// Next puzzle from q, false once the stage before has stopped and q is empty
+static bool take (Pipeline& p, Queue& q, Stage& from, Stage& me, Puzzle& x)
+{
+    Clock::time_point start = Clock::now();
+    int tries = 0;
+    bool got;
+    while (!(got = q.pop(x)) && !p.finished)
+    {
+        if (from.running==0)
+        {
+            got = q.pop(x);
+            break;
+        }
+        backOff(tries);
+    }
+    me.starved += since(start);
+    return got && !p.finished;
+}
+
+// Waits for room in q, false if the run finished first
+static bool give (Pipeline& p, Queue& q, Stage& me, Puzzle& x)
+{
+    Clock::time_point start = Clock::now();
+    int tries = 0;
+    bool put;
+    while (!(put = q.push(x)) && !p.finished)
+        backOff(tries);
+    me.blocked += since(start);
+    return put;
+}
+
+///////////////// ** Stages ** //////////////////
+
+static void makeGrids (Pipeline& p, Stage& me)
+{
+    const Geometry& g = p.job.g;
+    Solver solver(g);
+    solver.setRandom(true);
+    std::vector<int> empty(g.N(),0);
+    Puzzle x;
+    while (!p.finished)
+    {
+        x.board.assign(g.N(),0);
+        solver.load(&empty[0]);
+        if (!solver.solve(&x.board[0]))
+        {
+            me.dropped++;
+            continue;
+        }
+        me.done++;
+        if (!give(p,p.grids,me,x))
+            break;
+    }
+    me.running--;
+}
+
+static void removeClues (Pipeline& p, Stage& from, Stage& me)
+{
+    int N = p.job.g.N();
+    Solver solver(p.job.g);
+    Grader grader(p.job.g);
+    std::vector<int> order(N);
+    Puzzle x;
+    while (take(p,p.grids,from,me,x))
+    {
+        SearchStatus status;
+        if (p.job.level>=0)
+        {
+            // Entries only come out while the puzzle stays no harder than
+            // the level wanted, so a hard level isn't left to chance
+            status = grader.reduce((Grade::Level)p.job.level,&x.board[0],x.grade,p.job.limits);
+        }
+        else
+        {
+            for (int i = 0; i < N; ++i)
+                order[i] = i;
+            for (int i = N-1; i > 0; --i)
+                std::swap(order[i],order[rand()%(i+1)]);
+
+            // Take entries out while the puzzle stays unique
+            Budget budget(p.job.limits);
+            solver.setBudget(&budget);
+            for (int k = 0; k < N && !budget.exhausted(); ++k)
+            {
+                int n = order[k], v = x.board[n];
+                x.board[n] = 0;
+                solver.load(&x.board[0]);
+                if (solver.count(2)!=1)
+                    x.board[n] = v;
+            }
+            solver.setBudget(0);
+            status = budget.exhausted() ? GaveUp : Found;
+        }
+
+        if (status==NotFound && ++p.misses >= MaxMisses) // easier than wanted, once too often
+        {
+            p.gaveUp = true;
+            p.finished = true;
+        }
+        if (status!=Found)
+        {
+            me.dropped++;
+            continue;
+        }
+        p.misses = 0;
+        me.done++;
+        if (!give(p,p.puzzles,me,x))
+            break;
+    }
+    me.running--;
+}
+
+static void grade (Pipeline& p, Stage& from, Stage& me)
+{
+    Grader grader(p.job.g);
+    Puzzle x;
+    while (take(p,p.puzzles,from,me,x))
+    {
+        if (grader.grade(&x.board[0],x.grade,p.job.limits)!=Found
+            || (p.job.level>=0 && x.grade.level!=p.job.level))
+        {
+            me.dropped++;
+            continue;
+        }
+        me.done++;
+        if (!give(p,p.graded,me,x))
+            break;
+    }
+    me.running--;
+}
+
+static void dedupe (Pipeline& p, Stage& from, Stage& me)
+{
+    const Geometry& g = p.job.g;
+    bool canonical = g==Geometry::square(3);
+    PuzzleSet forms;
+    std::unordered_set<std::string> seen;
+    Puzzle x;
+    while (take(p,p.graded,from,me,x))
+    {
+        bool fresh;
+        if (canonical)
+            fresh = forms.insert(&x.board[0]);
+        else
+            fresh = seen.insert(std::string(x.board.begin(),x.board.end())).second;
+        if (!fresh)
+        {
+            me.dropped++;
+            continue;
+        }
+        me.done++;
+        if (!give(p,p.fresh,me,x))
+            break;
+    }
+    me.running--;
+}
+
+///////////////// ** Running ** //////////////////
+
+static void report (Stage *const stages[], int n, double seconds)
+{
+    fprintf(stderr,"%-8s %7s %10s %10s %10s %6s %8s %8s\n",
+            "stage","threads","out","dropped","per sec","busy","starved","blocked");
+    for (int i = 0; i < n; ++i)
+    {
+        const Stage& s = *stages[i];
+        double total = s.threads*seconds*1e6;
+        double starved = total>0 ? 100*s.starved/total : 0;
+        double blocked = total>0 ? 100*s.blocked/total : 0;
+        fprintf(stderr,"%-8s %7d %10llu %10llu %10.1f %5.0f%% %7.0f%% %7.0f%%\n",
+                s.name,s.threads,(unsigned long long)s.done,(unsigned long long)s.dropped,
+                seconds>0 ? s.done/seconds : 0,std::max(0.0,100-starved-blocked),starved,blocked);
+    }
+}
+
+int runPipeline (const PipelineJob& job, const char *out)
+{
+    const Geometry& g = job.g;
+    int N = g.N();
+
+    size_t length = strlen(out);
+    bool packed = length>4 && strcmp(out+length-4,".sdb")==0;
+    PuzzleWriter text;
+    PuzzleDbWriter pack;
+    if (packed ? !pack.open(out,g) : !text.open(out))
+    {
+        perror("sudokucli");
+        return 1;
+    }
+
+    int threads = job.threads>0 ? job.threads : std::thread::hardware_concurrency();
+    threads = std::max(threads,1);
+
+    // Taking clues out is by far the slowest step, so it gets every thread
+    // asked for, grading a quarter and the rest one each
+    Stage grids("grids",1), clues("clues",threads), graded("grade",std::max(1,threads/4));
+    Stage fresh("dedupe",1), written("write",1);
+    Stage *const stages[] = { &grids, &clues, &graded, &fresh, &written };
+    Pipeline p(job,4*threads+16);
+
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> pool;
+    pool.push_back(std::thread(makeGrids,std::ref(p),std::ref(grids)));
+    for (int t = 0; t < clues.threads; ++t)
+        pool.push_back(std::thread(removeClues,std::ref(p),std::ref(grids),std::ref(clues)));
+    for (int t = 0; t < graded.threads; ++t)
+        pool.push_back(std::thread(grade,std::ref(p),std::ref(clues),std::ref(graded)));
+    pool.push_back(std::thread(dedupe,std::ref(p),std::ref(graded),std::ref(fresh)));
+
+    // Writing is done here, and stops everything once there are enough
+    Puzzle x;
+    while (written.done < job.count && take(p,p.fresh,fresh,written,x))
+    {
+        if (packed)
+            pack.append(&x.board[0]);
+        else
+            text.write(&x.board[0],N);
+        written.done++;
+    }
+    p.finished = true;
+    written.running--;
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+
+    report(stages,5,std::chrono::duration<double>(Clock::now()-start).count());
+    bool ok = packed ? pack.close() : text.close();
+    if (p.gaveUp)
+    {
+        fprintf(stderr,"sudokucli: no %s puzzle in %d grids in a row, giving up with %llu of %llu written\n",
+                levelName((Grade::Level)job.level),(int)MaxMisses,(unsigned long long)written.done,job.count);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "geometry.h"
+#include "solver.h"
+
+// Builds a set of new puzzles with every stage running at once:
+//
+//   grids    random full grids
+//   clues    entries taken out while the solution stays unique, and
+//            for a wanted level no harder than it
+//   grade    rated, and dropped unless of the wanted level
+//   dedupe   dropped if seen before (by canonical form for 9x9)
+//   write    text, or a puzzle pack when out ends in .sdb
+//
+// Stages hand puzzles on through bounded lock-free queues. A stage
+// waits when the next queue is full, so a slow stage holds back the
+// ones before it instead of letting work pile up. When enough puzzles
+// are written, each stage's throughput and time spent working or
+// waiting are reported on stderr. A level that many grids in a row
+// can't reach ends the run with an error instead of going on forever.
+struct PipelineJob
+{
+    Geometry g;
+    unsigned long long count; // puzzles to write
+    int level;                // a Grade::Level, -1 for any
+    int threads;              // for clues and grading, 0 for one per core
+    Limits limits;            // per puzzle, for clues and grading
+};
+
+int runPipeline (const PipelineJob&, const char *out);
+
+#endif // PIPELINE_H
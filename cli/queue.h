@@ -0,0 +1,102 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// Fixed size queue for any number of producers and consumers, without
+// locks (Vyukov's bounded queue). Every slot carries a sequence number
+// that says whether it is free for the push of this lap round the ring
+// or holds an item for the pop of this lap, so a push or pop is one
+// compare and swap on its own end of the ring. push() fails when the
+// queue is full and pop() when it is empty; what to do then (wait, give
+// up) is left to the caller.
+template <class T>
+class BoundedQueue
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T item;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head; // next push
+    alignas(64) std::atomic<size_t> tail; // next pop
+
+public:
+    BoundedQueue(size_t capacity) // rounded up to a power of two
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n *= 2;
+        slots.reset(new Slot[n]);
+        mask = n-1;
+        for (size_t i = 0; i < n; ++i)
+            slots[i].seq.store(i,std::memory_order_relaxed);
+        head.store(0,std::memory_order_relaxed);
+        tail.store(0,std::memory_order_relaxed);
+    }
+
+    bool push (T& item) // moves item in, false if full
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        Slot *s;
+        while (1)
+        {
+            s = &slots[pos & mask];
+            size_t seq = s->seq.load(std::memory_order_acquire);
+            long d = (long)(seq-pos);
+            if (d==0)
+            {
+                if (head.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                    break;
+            }
+            else if (d<0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        s->item = std::move(item);
+        s->seq.store(pos+1,std::memory_order_release);
+        return true;
+    }
+
+    bool pop (T& item) // false if empty
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Slot *s;
+        while (1)
+        {
+            s = &slots[pos & mask];
+            size_t seq = s->seq.load(std::memory_order_acquire);
+            long d = (long)(seq-(pos+1));
+            if (d==0)
+            {
+                if (tail.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                    break;
+            }
+            else if (d<0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(s->item);
+        s->seq.store(pos+mask+1,std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // QUEUE_H
@@ -0,0 +1,28 @@
+# Solver and puzzle file formats, shared by the GUI and the tools
+
+INCLUDEPATH += $$PWD
+
+SOURCES += $$PWD/sudoku.cpp \
+    $$PWD/canonical.cpp \
+    $$PWD/counter.cpp \
+    $$PWD/grade.cpp \
+    $$PWD/graph.cpp \
+    $$PWD/hint.cpp \
+    $$PWD/puzzledb.cpp \
+    $$PWD/puzzleio.cpp \
+    $$PWD/solver.cpp
+
+HEADERS += $$PWD/sudoku.h \
+    $$PWD/canonical.h \
+    $$PWD/counter.h \
+    $$PWD/geometry.h \
+    $$PWD/grade.h \
+    $$PWD/graph.h \
+    $$PWD/hint.h \
+    $$PWD/protocol.h \
+    $$PWD/puzzledb.h \
+    $$PWD/puzzleio.h \
+    $$PWD/solver.h
+
+CONFIG += thread
+QMAKE_CXXFLAGS += -std=c++11
@@ -0,0 +1,283 @@
+#include "counter.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+CountJob::CountJob(const Geometry& g)
+    : geom(g), total(0), nodes(0), seconds(0)
+{
+}
+
+void CountJob::start (const int board[])
+{
+    Item item;
+    item.board.assign(board,board+geom.N());
+    for (size_t i = 0; i < item.board.size(); ++i)
+        item.board[i] = item.board[i]<0 ? -item.board[i] : item.board[i];
+    pending.assign(1,item);
+    total = nodes = 0;
+    seconds = 0;
+}
+
+SearchStats CountJob::stats () const
+{
+    SearchStats s;
+    s.nodes = nodes;
+    s.seconds = seconds;
+    s.gaveUp = !pending.empty();
+    return s;
+}
+
+///////////////// ** Checkpoints ** //////////////////
+
+// Text, one item per line: its board, then the number of choices and
+// node, value and values left for each.
+bool CountJob::save (const char *path) const
+{
+    std::string tmp = std::string(path)+".tmp";
+    FILE *f = fopen(tmp.c_str(),"w");
+    if (!f)
+        return false;
+
+    fprintf(f,"sudoku count 1\ngeometry %d %d %d %d\ncount %llu\nnodes %llu\nseconds %.3f\nitems %u\n",
+            geom.SR,geom.SC,geom.NSV,geom.NSH,total,nodes,seconds,(unsigned)pending.size());
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        const Item& item = pending[i];
+        for (size_t n = 0; n < item.board.size(); ++n)
+            fputc(symbolChar(item.board[n]),f);
+        fprintf(f," %u",(unsigned)item.path.size());
+        for (size_t k = 0; k < item.path.size(); ++k)
+            fprintf(f," %d %d %u",item.path[k].node,item.path[k].value,item.path[k].left);
+        fputc('\n',f);
+    }
+
+    bool ok = fflush(f)==0 && fsync(fileno(f))==0;
+    ok = fclose(f)==0 && ok;
+    return ok && rename(tmp.c_str(),path)==0;
+}
+
+bool CountJob::load (const char *path)
+{
+    FILE *f = fopen(path,"r");
+    if (!f)
+        return false;
+
+    Geometry g;
+    unsigned long long count, used;
+    double spent;
+    unsigned items;
+    bool ok = fscanf(f,"sudoku count 1 geometry %d %d %d %d count %llu nodes %llu seconds %lf items %u",
+                     &g.SR,&g.SC,&g.NSV,&g.NSH,&count,&used,&spent,&items)==8 && g==geom;
+
+    int N = geom.N();
+    char format[16];
+    snprintf(format,sizeof(format),"%%%ds",N);
+    std::vector<char> text(N+1);
+    std::vector<Item> list(ok ? items : 0);
+
+    for (unsigned i = 0; i < list.size() && ok; ++i)
+    {
+        Item& item = list[i];
+        unsigned length;
+        ok = fscanf(f,format,&text[0])==1 && fscanf(f,"%u",&length)==1 && (int)length<=N;
+        for (int n = 0; n < N && ok; ++n)
+        {
+            int v = symbolValue(text[n]);
+            ok = v>=0 && v<=geom.S();
+            item.board.push_back(v);
+        }
+        for (unsigned k = 0; k < length && ok; ++k)
+        {
+            Solver::Decision d;
+            ok = fscanf(f,"%d %d %u",&d.node,&d.value,&d.left)==3;
+            item.path.push_back(d);
+        }
+    }
+    fclose(f);
+
+    if (!ok)
+        return false;
+    pending.swap(list);
+    total = count;
+    nodes = used;
+    seconds = spent;
+    return true;
+}
+
+///////////////// ** Counting ** //////////////////
+
+// Splits the oldest choices of searches under way into items of their
+// own until there are wanted items
+void CountJob::spill (size_t wanted)
+{
+    // New items have no path, so going on to the end of the list is fine
+    size_t i = 0;
+    while (i < pending.size() && pending.size() < wanted)
+    {
+        bool usedUp = false;
+        while (pending.size() < wanted && !pending[i].path.empty())
+        {
+            Solver::Decision d = pending[i].path[0];
+            std::vector<int> board = pending[i].board;
+            for (Solver::Mask m = d.left; m; m &= m-1)
+            {
+                Item item;
+                item.board = board;
+                item.board[d.node] = __builtin_ctz(m)+1;
+                pending.push_back(item);
+            }
+
+            if (pending[i].path.size()==1) // nothing under way below it, the item is used up
+            {
+                pending[i] = pending.back();
+                pending.pop_back();
+                usedUp = true;
+                break;
+            }
+            pending[i].board[d.node] = d.value;
+            pending[i].path.erase(pending[i].path.begin());
+        }
+        if (!usedUp) // otherwise slot i now holds the last item, look at it next
+            ++i;
+    }
+}
+
+SearchStatus CountJob::run (int threads, const Limits& limits, double interval, const char *path)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (threads<=0)
+        threads = std::thread::hardware_concurrency();
+    if (threads<=0)
+        threads = 1;
+
+    Clock::time_point start = Clock::now(), saved = start, paused = start;
+    std::mutex lock;
+    std::condition_variable wake;    // workers wait on it
+    std::condition_variable changed; // the coordinator waits on it
+    CancelToken pause;
+    int idle = 0, parked = 0;
+    unsigned generation = 0;
+    bool stopping = false, outOfBudget = false;
+    unsigned long long used = 0; // nodes in this run
+
+    auto worker = [&]() {
+        Solver solver(geom);
+        Item item;
+        std::unique_lock<std::mutex> l(lock);
+        while (!stopping)
+        {
+            // Wait out a pause, or for work
+            if (pause.cancelled() || pending.empty())
+            {
+                bool pausing = pause.cancelled();
+                unsigned g = generation;
+                (pausing ? parked : idle)++;
+                changed.notify_all();
+                while (!stopping && (pausing ? generation==g : pending.empty() && !pause.cancelled()))
+                    wake.wait(l);
+                (pausing ? parked : idle)--;
+                continue;
+            }
+
+            item = pending.back();
+            pending.pop_back();
+            double elapsed = std::chrono::duration<double>(Clock::now()-start).count();
+            Limits slice(limits.seconds>0 ? std::max(limits.seconds-elapsed,1e-9) : 0, 0, &pause);
+            if (limits.maxNodes)
+                slice.maxNodes = limits.maxNodes>used ? (limits.maxNodes-used)/threads+1 : 1;
+            l.unlock();
+
+            Budget budget(slice);
+            solver.setBudget(&budget);
+            unsigned long long found = 0;
+            if (solver.resume(&item.board[0],item.path))
+                found = solver.count();
+            bool stopped = solver.stopped();
+            if (stopped)
+                solver.frontier(item.path);
+
+            l.lock();
+            total += found;
+            nodes += budget.stats().nodes;
+            used += budget.stats().nodes;
+            if (stopped) // back on the list, to be taken up again after the pause
+            {
+                pending.push_back(item);
+                if (!pause.cancelled())
+                {
+                    outOfBudget = true;
+                    pause.cancel();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t)
+        pool.push_back(std::thread(worker));
+
+    SearchStatus status = Found;
+    {
+        std::unique_lock<std::mutex> l(lock);
+        while (1)
+        {
+            changed.wait_for(l,std::chrono::milliseconds(10));
+            if (idle==threads && pending.empty())
+                break;
+
+            Clock::time_point now = Clock::now();
+            double elapsed = std::chrono::duration<double>(now-start).count();
+            bool stop = outOfBudget || (limits.token && limits.token->cancelled())
+                        || (limits.seconds>0 && elapsed>=limits.seconds)
+                        || (limits.maxNodes && used>=limits.maxNodes);
+            bool checkpoint = path && interval>0 && std::chrono::duration<double>(now-saved).count()>=interval;
+            bool hungry = idle>0 && pending.empty() && std::chrono::duration<double>(now-paused).count()>=0.05;
+            if (!stop && !checkpoint && !hungry)
+                continue;
+
+            // Stop every search where it is and put it back on the list
+            pause.cancel();
+            while (idle+parked < threads)
+                changed.wait(l);
+            if (idle==threads && pending.empty())
+                break;
+
+            spill(threads*4);
+            seconds += std::chrono::duration<double>(Clock::now()-start).count()-
+                       std::chrono::duration<double>(paused-start).count();
+            paused = Clock::now();
+            if (path && (checkpoint || stop))
+            {
+                if (!save(path))
+                    perror("sudoku: checkpoint");
+                saved = paused;
+            }
+            if (stop)
+            {
+                status = GaveUp;
+                break;
+            }
+
+            pause.reset();
+            generation++;
+            wake.notify_all();
+        }
+
+        seconds += std::chrono::duration<double>(Clock::now()-paused).count();
+        stopping = true;
+        wake.notify_all();
+    }
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+
+    if (status==GaveUp)
+        return GaveUp;
+    return total ? Found : NotFound;
+}
@@ -0,0 +1,52 @@
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include "geometry.h"
+#include "solver.h"
+#include <vector>
+
+// Solution counts that may take hours. The work left is kept as a list
+// of items, each a board and the choices of a search under way on it
+// (see Solver::frontier), together with the count so far. Threads take
+// items one at a time. Now and then they are all paused, their searches
+// go back into the list, and the list can be written to a checkpoint
+// file. The same pause splits the oldest choices of the searches into
+// new items whenever a thread has run out of work, so the threads stay
+// busy to the end.
+class CountJob
+{
+public:
+    struct Item
+    {
+        std::vector<int> board;
+        std::vector<Solver::Decision> path; // empty for a search not started
+    };
+
+private:
+    Geometry geom;
+    std::vector<Item> pending;
+    unsigned long long total, nodes;
+    double seconds; // spent in earlier runs
+
+private:
+    void spill (size_t);
+
+public:
+    CountJob(const Geometry&);
+
+    void start (const int[]);   // a new count of this board
+    bool load (const char*);    // carry on from a checkpoint
+    bool save (const char*) const; // written aside and renamed over the old one
+
+    const Geometry& geometry () const { return geom; }
+    bool finished () const { return pending.empty(); }
+    unsigned long long count () const { return total; } // so far, or in all once finished
+    SearchStats stats () const;
+
+    // Counts with threads (<= 0 for every core) until finished or the
+    // limits run out (GaveUp), saving a checkpoint to path every interval
+    // seconds, and once more when stopping early. path may be null.
+    SearchStatus run (int threads, const Limits& = Limits(), double interval = 0, const char *path = 0);
+};
+
+#endif // COUNTER_H
@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Solver daemon on a Unix socket
+#
+#-------------------------------------------------
+
+CONFIG   += console
+CONFIG   -= qt app_bundle
+
+TARGET = sudokud
+TEMPLATE = app
+
+include(../core.pri)
+
+SOURCES += main.cpp
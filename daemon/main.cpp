@@ -0,0 +1,734 @@
+#include "sudoku.h"
+#include "solver.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// sudokud answers solve, count, generate, validate and stats requests
+// (see protocol.h) on a Unix socket. One thread does all the socket work
+// with epoll; requests it reads are queued in batches for a fixed pool
+// of workers, each of which takes as many waiting requests as it can at
+// once and hands back the answers through an eventfd.
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal (int)
+{
+    stopping = 1;
+}
+
+struct Request
+{
+    unsigned long long conn;
+    unsigned id;
+    int op;
+    Geometry g;
+    unsigned arg;
+    unsigned timeoutMs;
+    std::string board;
+    Clock::time_point arrived;
+};
+
+struct Response
+{
+    unsigned long long conn;
+    std::string frame;
+};
+
+///////////////// ** Counters ** //////////////////
+
+// Latencies go in power of two buckets of microseconds
+struct Counters
+{
+    enum { Buckets = 40 };
+
+    Clock::time_point started;
+    std::atomic<unsigned long long> requests, responses, batches, batched;
+    std::atomic<unsigned long long> gaveUp, badRequests, connections;
+    std::atomic<unsigned long long> perOp[Protocol::Stats+1];
+    std::atomic<unsigned long long> latency[Buckets];
+    std::atomic<unsigned long long> maxLatency;
+
+    Counters() : started(Clock::now()), requests(0), responses(0), batches(0), batched(0),
+                 gaveUp(0), badRequests(0), connections(0), maxLatency(0)
+    {
+        for (int i = 0; i <= Protocol::Stats; ++i)
+            perOp[i] = 0;
+        for (int i = 0; i < Buckets; ++i)
+            latency[i] = 0;
+    }
+
+    void answered (const Request& r)
+    {
+        unsigned long long us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now()-r.arrived).count();
+        int b = 0;
+        while (b < Buckets-1 && (1ULL<<b) <= us)
+            b++;
+        latency[b]++;
+        unsigned long long m = maxLatency;
+        while (us > m && !maxLatency.compare_exchange_weak(m,us))
+            ;
+        responses++;
+    }
+
+    unsigned long long percentile (double p) const // upper bound of the bucket, in microseconds
+    {
+        unsigned long long total = 0, seen = 0;
+        for (int i = 0; i < Buckets; ++i)
+            total += latency[i];
+        for (int i = 0; i < Buckets; ++i)
+        {
+            seen += latency[i];
+            if (total && seen >= p*total)
+                return 1ULL<<i;
+        }
+        return 0;
+    }
+
+    std::string report () const
+    {
+        double up = std::chrono::duration<double>(Clock::now()-started).count();
+        unsigned long long b = batches;
+        char text[1024];
+        snprintf(text,sizeof(text),
+                 "uptime %.1f\n"
+                 "connections %llu\n"
+                 "requests %llu\n"
+                 "responses %llu\n"
+                 "requests_per_second %.1f\n"
+                 "solve %llu\ncount %llu\ngenerate %llu\nvalidate %llu\nstats %llu\n"
+                 "gave_up %llu\n"
+                 "bad_requests %llu\n"
+                 "batches %llu\n"
+                 "average_batch %.2f\n"
+                 "latency_p50_us %llu\nlatency_p90_us %llu\nlatency_p99_us %llu\nlatency_max_us %llu\n",
+                 up, (unsigned long long)connections, (unsigned long long)requests,
+                 (unsigned long long)responses, up>0 ? requests/up : 0.0,
+                 (unsigned long long)perOp[Protocol::Solve], (unsigned long long)perOp[Protocol::Count],
+                 (unsigned long long)perOp[Protocol::Generate], (unsigned long long)perOp[Protocol::Validate],
+                 (unsigned long long)perOp[Protocol::Stats],
+                 (unsigned long long)gaveUp, (unsigned long long)badRequests,
+                 b, b ? (double)batched/b : 0.0,
+                 percentile(0.5), percentile(0.9), percentile(0.99), (unsigned long long)maxLatency);
+        return text;
+    }
+};
+
+static Counters counters;
+
+///////////////// ** Queues ** //////////////////
+
+class BatchQueue
+{
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Request> queue;
+    bool closed;
+
+public:
+    BatchQueue() : closed(false) {}
+
+    void push (std::vector<Request>& batch)
+    {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                queue.push_back(Request());
+                std::swap(queue.back(),batch[i]);
+            }
+        }
+        batch.clear();
+        ready.notify_all();
+    }
+
+    // Takes up to max waiting requests, blocking while there are none
+    bool pop (std::vector<Request>& batch, size_t max)
+    {
+        std::unique_lock<std::mutex> l(lock);
+        while (queue.empty() && !closed)
+            ready.wait(l);
+        if (queue.empty())
+            return false;
+        while (!queue.empty() && batch.size() < max)
+        {
+            batch.push_back(Request());
+            std::swap(batch.back(),queue.front());
+            queue.pop_front();
+        }
+        return true;
+    }
+
+    void close ()
+    {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+};
+
+class Completions
+{
+private:
+    std::mutex lock;
+    std::vector<Response> done;
+    int event;
+
+public:
+    Completions(int fd) : event(fd) {}
+
+    void push (std::vector<Response>& batch)
+    {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                done.push_back(Response());
+                std::swap(done.back(),batch[i]);
+            }
+        }
+        batch.clear();
+        unsigned long long one = 1;
+        if (write(event,&one,sizeof(one))<0 && errno!=EAGAIN)
+            perror("sudokud: eventfd");
+    }
+
+    void take (std::vector<Response>& out)
+    {
+        std::lock_guard<std::mutex> l(lock);
+        out.swap(done);
+    }
+};
+
+///////////////// ** Workers ** //////////////////
+
+class Worker
+{
+private:
+    // Solvers are kept per geometry, so requests do not rebuild them
+    std::vector< std::pair<Geometry,Solver*> > solvers;
+    double defaultSeconds;
+
+private:
+    Solver& solver (const Geometry& g)
+    {
+        for (size_t i = 0; i < solvers.size(); ++i)
+            if (solvers[i].first==g)
+                return *solvers[i].second;
+        solvers.push_back(std::make_pair(g,new Solver(g)));
+        return *solvers.back().second;
+    }
+
+    static void reply (Response& out, const Request& r, Protocol::Status status,
+                       unsigned long long value, const std::string& payload = std::string())
+    {
+        unsigned char h[Protocol::ResponseHeader];
+        Protocol::response(h,r.id,r.op,status,value,payload.size());
+        out.conn = r.conn;
+        out.frame.assign((const char*)h,sizeof(h));
+        out.frame += payload;
+    }
+
+public:
+    Worker(double seconds) : defaultSeconds(seconds) {}
+
+    ~Worker()
+    {
+        for (size_t i = 0; i < solvers.size(); ++i)
+            delete solvers[i].second;
+    }
+
+    void handle (const Request& r, Response& out)
+    {
+        const Geometry& g = r.g;
+        int N = g.N();
+        bool needsBoard = r.op!=Protocol::Generate;
+        if (g.SR<1 || g.SC<1 || g.NSV<1 || g.NSH<1 || g.S()>Solver::MaxValues || N>4096
+            || (needsBoard && (int)r.board.size()!=N) || r.op<Protocol::Solve || r.op>=Protocol::Stats)
+        {
+            counters.badRequests++;
+            reply(out,r,Protocol::BadRequest,0);
+            return;
+        }
+
+        std::vector<int> board(N);
+        for (int i = 0; i < N && needsBoard; ++i)
+            board[i] = (unsigned char)r.board[i];
+
+        Budget budget(Limits(r.timeoutMs ? r.timeoutMs/1000.0 : defaultSeconds));
+
+        if (r.op==Protocol::Generate)
+        {
+            Sudoku sud(g.SR,g.SC,g.NSV,g.NSH);
+            SearchStatus status = sud.generateGrid(r.arg,Limits(r.timeoutMs ? r.timeoutMs/1000.0 : defaultSeconds));
+            std::string puzzle(N,0);
+            for (int i = 0; i < N; ++i)
+            {
+                const Node& n = sud.GetNode(i/g.C(),i%g.C());
+                puzzle[i] = n.size()==1 ? *n.begin() : 0;
+            }
+            if (status==GaveUp)
+                counters.gaveUp++;
+            Protocol::Status answer = status==Found ? Protocol::Ok : status==GaveUp ? Protocol::GaveUp : Protocol::NotFound;
+            reply(out,r,answer,sud.lastStats().nodes,puzzle);
+            return;
+        }
+
+        Solver& s = solver(g);
+        s.setBudget(&budget);
+        if (!s.load(&board[0]))
+        {
+            counters.badRequests++;
+            reply(out,r,Protocol::BadRequest,0);
+            return;
+        }
+
+        if (r.op==Protocol::Solve)
+        {
+            if (s.solve(&board[0]))
+            {
+                std::string solution(N,0);
+                for (int i = 0; i < N; ++i)
+                    solution[i] = board[i];
+                reply(out,r,Protocol::Ok,s.nodesVisited(),solution);
+            }
+            else
+            {
+                reply(out,r,s.stopped() ? Protocol::GaveUp : Protocol::NotFound,s.nodesVisited());
+            }
+        }
+        else if (r.op==Protocol::Count)
+        {
+            unsigned long long n = s.count(r.arg);
+            reply(out,r,s.stopped() ? Protocol::GaveUp : Protocol::Ok,n);
+        }
+        else // Validate: nodes clashing with a peer, and 0, 1 or 2 for none, one or several solutions
+        {
+            Sudoku sud(g.SR,g.SC,g.NSV,g.NSH,&board[0]);
+            sud.findBadNodes();
+            std::string conflicts(N,0);
+            const std::set<int>& bad = sud.badNodes();
+            for (std::set<int>::const_iterator it = bad.begin(); it != bad.end(); ++it)
+                conflicts[*it] = 1;
+            unsigned long long n = bad.empty() ? s.count(2) : 0;
+            reply(out,r,s.stopped() ? Protocol::GaveUp : Protocol::Ok,n,conflicts);
+        }
+
+        if (s.stopped())
+            counters.gaveUp++;
+        s.setBudget(0);
+    }
+};
+
+static void work (BatchQueue *queue, Completions *completions, double seconds, size_t batchSize)
+{
+    Worker worker(seconds);
+    std::vector<Request> batch;
+    std::vector<Response> answers;
+    batch.reserve(batchSize);
+
+    while (queue->pop(batch,batchSize))
+    {
+        counters.batches++;
+        counters.batched += batch.size();
+
+        answers.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            worker.handle(batch[i],answers[i]);
+            counters.answered(batch[i]);
+        }
+        completions->push(answers);
+        batch.clear();
+    }
+}
+
+///////////////// ** Connections ** //////////////////
+
+// Past either limit a client's requests wait in its socket until it
+// takes some of its answers
+static const size_t MaxBacklog = 1<<22; // answer bytes not yet sent
+static const unsigned MaxQueued = 4096; // requests with the workers
+
+struct Connection
+{
+    int fd;
+    unsigned long long serial;
+    std::string in;
+    std::string out;
+    size_t sent;
+    unsigned queued; // requests with the workers
+    bool writing;    // waiting for the socket to take more
+    bool reading;    // waiting for requests
+    bool closing;    // the client is done sending, close once it has all answers
+};
+
+class Server
+{
+private:
+    int listener, epoll, event;
+    BatchQueue& queue;
+    Completions& completions;
+    std::unordered_map<int,Connection> connections;
+    std::unordered_map<unsigned long long,int> bySerial;
+    unsigned long long serials;
+    std::vector<Request> batch;
+
+private:
+    // Waits for room while there are answers to send, and for requests
+    // unless the client is done sending or too far behind on its answers
+    void watch (Connection& c)
+    {
+        bool writing = c.sent < c.out.size();
+        bool reading = !c.closing && c.out.size()-c.sent < MaxBacklog && c.queued < MaxQueued;
+        if (writing==c.writing && reading==c.reading)
+            return;
+
+        struct epoll_event ev;
+        memset(&ev,0,sizeof(ev));
+        ev.events = 0;
+        if (reading)
+            ev.events |= EPOLLIN;
+        if (writing)
+            ev.events |= EPOLLOUT;
+        ev.data.fd = c.fd;
+        epoll_ctl(epoll,EPOLL_CTL_MOD,c.fd,&ev);
+        c.writing = writing;
+        c.reading = reading;
+    }
+
+    bool finished (const Connection& c) const
+    {
+        return c.closing && !c.queued && c.out.empty();
+    }
+
+    void drop (Connection& c)
+    {
+        epoll_ctl(epoll,EPOLL_CTL_DEL,c.fd,0);
+        ::close(c.fd);
+        bySerial.erase(c.serial);
+        connections.erase(c.fd);
+    }
+
+    bool flush (Connection& c) // false if the connection broke
+    {
+        while (c.sent < c.out.size())
+        {
+            ssize_t n = ::write(c.fd,c.out.data()+c.sent,c.out.size()-c.sent);
+            if (n<0 && errno==EINTR)
+                continue;
+            if (n<0 && (errno==EAGAIN || errno==EWOULDBLOCK))
+                break;
+            if (n<=0)
+                return false;
+            c.sent += n;
+        }
+        if (c.sent==c.out.size())
+        {
+            c.out.clear();
+            c.sent = 0;
+        }
+        watch(c);
+        return true;
+    }
+
+    void accept ()
+    {
+        while (1)
+        {
+            int fd = accept4(listener,0,0,SOCK_NONBLOCK|SOCK_CLOEXEC);
+            if (fd<0)
+                return;
+
+            Connection& c = connections[fd];
+            c.fd = fd;
+            c.serial = ++serials;
+            c.sent = 0;
+            c.queued = 0;
+            c.writing = false;
+            c.reading = true;
+            c.closing = false;
+            bySerial[c.serial] = fd;
+            counters.connections++;
+
+            struct epoll_event ev;
+            memset(&ev,0,sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epoll,EPOLL_CTL_ADD,fd,&ev);
+        }
+    }
+
+    bool read (Connection& c) // false if the connection broke
+    {
+        // A megabyte at most, the rest waits for the next turn
+        char buf[1<<16];
+        for (int chunks = 0; chunks < 16; )
+        {
+            ssize_t n = ::read(c.fd,buf,sizeof(buf));
+            if (n<0 && errno==EINTR)
+                continue;
+            if (n<0 && (errno==EAGAIN || errno==EWOULDBLOCK))
+                break;
+            if (n<0)
+                return false;
+            if (n==0) // the frames already in still get their answers
+            {
+                c.closing = true;
+                break;
+            }
+            c.in.append(buf,n);
+            chunks++;
+        }
+
+        // Cut out every complete frame, all of them go to the workers as one batch
+        size_t pos = 0;
+        const unsigned char *p = (const unsigned char*)c.in.data();
+        while (c.in.size()-pos >= 4)
+        {
+            unsigned length = Protocol::get32(p+pos);
+            if (length < Protocol::RequestHeader-4 || length > Protocol::MaxFrame)
+                return false;
+            if (c.in.size()-pos < 4+length)
+                break;
+
+            const unsigned char *h = p+pos;
+            Request r;
+            r.conn = c.serial;
+            r.id = Protocol::get32(h+4);
+            r.op = h[8];
+            r.g = Protocol::geometry(h);
+            r.arg = Protocol::get32(h+16);
+            r.timeoutMs = Protocol::get32(h+20);
+            r.board.assign((const char*)h+Protocol::RequestHeader,length+4-Protocol::RequestHeader);
+            r.arrived = Clock::now();
+            pos += 4+length;
+
+            counters.requests++;
+            if (r.op>=Protocol::Solve && r.op<=Protocol::Stats)
+                counters.perOp[r.op]++;
+
+            if (r.op==Protocol::Stats) // answered right here, it only reads counters
+            {
+                std::string text = counters.report();
+                unsigned char rh[Protocol::ResponseHeader];
+                Protocol::response(rh,r.id,r.op,Protocol::Ok,0,text.size());
+                c.out.append((const char*)rh,sizeof(rh));
+                c.out += text;
+                counters.answered(r);
+                continue;
+            }
+            batch.push_back(Request());
+            std::swap(batch.back(),r);
+            c.queued++;
+        }
+        c.in.erase(0,pos);
+
+        if (!batch.empty())
+            queue.push(batch);
+        return flush(c);
+    }
+
+    void deliver ()
+    {
+        unsigned long long n;
+        while (::read(event,&n,sizeof(n))>0)
+            ;
+
+        std::vector<Response> done;
+        completions.take(done);
+        for (size_t i = 0; i < done.size(); ++i)
+        {
+            std::unordered_map<unsigned long long,int>::iterator it = bySerial.find(done[i].conn);
+            if (it==bySerial.end()) // the client went away
+                continue;
+            Connection& c = connections[it->second];
+            c.out += done[i].frame;
+            c.queued--;
+        }
+
+        // Write each connection once, after all of its answers are in
+        for (size_t i = 0; i < done.size(); ++i)
+        {
+            std::unordered_map<unsigned long long,int>::iterator it = bySerial.find(done[i].conn);
+            if (it==bySerial.end())
+                continue;
+            Connection& c = connections[it->second];
+            bool ok = true;
+            if (c.writing) // with fewer requests out it may read again
+                watch(c);
+            else
+                ok = flush(c);
+            if (!ok || finished(c))
+                drop(c);
+        }
+    }
+
+public:
+    Server(int l, int e, BatchQueue& q, Completions& d)
+        : listener(l), event(e), queue(q), completions(d), serials(0)
+    {
+        epoll = epoll_create1(EPOLL_CLOEXEC);
+
+        struct epoll_event ev;
+        memset(&ev,0,sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = listener;
+        epoll_ctl(epoll,EPOLL_CTL_ADD,listener,&ev);
+        ev.data.fd = event;
+        epoll_ctl(epoll,EPOLL_CTL_ADD,event,&ev);
+    }
+
+    void run ()
+    {
+        struct epoll_event events[64];
+        while (!stopping)
+        {
+            int n = epoll_wait(epoll,events,64,-1);
+            for (int i = 0; i < n; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd==listener)
+                {
+                    accept();
+                    continue;
+                }
+                if (fd==event)
+                {
+                    deliver();
+                    continue;
+                }
+
+                std::unordered_map<int,Connection>::iterator it = connections.find(fd);
+                if (it==connections.end())
+                    continue;
+                Connection& c = it->second;
+                // A hang up is the client gone both ways, nothing left to answer
+                bool ok = !(events[i].events & (EPOLLHUP|EPOLLERR));
+                if (ok && (events[i].events & EPOLLIN))
+                    ok = read(c);
+                if (ok && (events[i].events & EPOLLOUT))
+                    ok = flush(c);
+                if (!ok || finished(c))
+                    drop(c);
+            }
+        }
+    }
+};
+
+///////////////// ** Main ** //////////////////
+
+static void usage ()
+{
+    fprintf(stderr,
+            "usage: sudokud [-s socket] [-w workers] [-b batch] [-d secs]\n"
+            "\n"
+            "  -s socket   path to listen on, /tmp/sudokud.sock by default\n"
+            "  -w workers  solver threads, all cores by default\n"
+            "  -b batch    most requests a worker takes at once, 64 by default\n"
+            "  -d secs     time allowed per request without its own timeout, 10 by default\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "/tmp/sudokud.sock";
+    int workers = std::thread::hardware_concurrency();
+    size_t batchSize = 64;
+    double seconds = 10;
+
+    for (int a = 1; a < argc; a += 2)
+    {
+        if (a+1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        if (strcmp(argv[a],"-s")==0)
+            path = argv[a+1];
+        else if (strcmp(argv[a],"-w")==0)
+            workers = atoi(argv[a+1]);
+        else if (strcmp(argv[a],"-b")==0)
+            batchSize = atoi(argv[a+1]);
+        else if (strcmp(argv[a],"-d")==0)
+            seconds = atof(argv[a+1]);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (workers<1)
+        workers = 1;
+    if (batchSize<1)
+        batchSize = 1;
+
+    srand(time(NULL));
+
+    struct sockaddr_un addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr,"sudokud: socket path too long\n");
+        return 1;
+    }
+    strcpy(addr.sun_path,path);
+
+    int listener = socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    unlink(path);
+    if (listener<0 || bind(listener,(struct sockaddr*)&addr,sizeof(addr))<0 || listen(listener,128)<0)
+    {
+        perror("sudokud");
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa,0,sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT,&sa,0);
+    sigaction(SIGTERM,&sa,0);
+    signal(SIGPIPE,SIG_IGN);
+
+    int event = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    BatchQueue queue;
+    Completions completions(event);
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i)
+        pool.push_back(std::thread(work,&queue,&completions,seconds,batchSize));
+
+    fprintf(stderr,"sudokud: listening on %s with %d workers\n",path,workers);
+    Server server(listener,event,queue,completions);
+    server.run();
+
+    queue.close();
+    for (size_t i = 0; i < pool.size(); ++i)
+        pool[i].join();
+    unlink(path);
+    fprintf(stderr,"%s",counters.report().c_str());
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+// Shape of a sudoku board, with the same four dimensions the
+// Sudoku constructors take:
+// SR  = number of rows in a subgrid          (dim1)
+// SC  = number of columns in a subgrid       (dim2)
+// NSV = number of subgrids going vertically  (dim3)
+// NSH = number of subgrids going across      (dim4)
+struct Geometry
+{
+    int SR, SC, NSV, NSH;
+
+    Geometry (int dim1=3, int dim2=3, int dim3=3, int dim4=3)
+        : SR(dim1), SC(dim2), NSV(dim3), NSH(dim4) {}
+
+    // square board of n*n values with n*n subgrids, e.g. 3 -> 9x9
+    static Geometry square (int n) { return Geometry(n,n,n,n); }
+
+    int S () const { return SR*SC; }       // values per group
+    int R () const { return SR*NSV; }      // rows
+    int C () const { return SC*NSH; }      // columns
+    int N () const { return R()*C(); }     // nodes
+
+    bool operator== (const Geometry& g) const
+    {
+        return SR==g.SR && SC==g.SC && NSV==g.NSV && NSH==g.NSH;
+    }
+    bool operator!= (const Geometry& g) const { return !(*this==g); }
+};
+
+// Values are written as 1-9 and then A-Z for 10-35, 0 is an empty node.
+inline char symbolChar (int v)
+{
+    if (v<=0) return '0';
+    if (v<10) return '0'+v;
+    return 'A'+(v-10);
+}
+
+// Returns the value of a symbol, 0 for an empty node and -1 if the
+// character is not a symbol at all. Lower case letters are accepted.
+inline int symbolValue (char ch)
+{
+    if (ch>='0' && ch<='9') return ch-'0';
+    if (ch=='.') return 0;
+    if (ch>='A' && ch<='Z') return ch-'A'+10;
+    if (ch>='a' && ch<='z') return ch-'a'+10;
+    return -1;
+}
+
+#endif // GEOMETRY_H
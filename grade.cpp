@@ -0,0 +1,162 @@
+#include "grade.h"
+#include <stdlib.h>
+
+// What each step of a rule adds to the score, and the level it makes a puzzle
+static const int weights[Hint::NRules] = { 0, 0, 1, 2, 4, 4, 6, 8, 10, 15 };
+
+static Grade::Level levelOf (Hint::Rule r)
+{
+    if (r<=Hint::NakedSingle) return Grade::Easy;
+    if (r<=Hint::Claiming) return Grade::Medium;
+    if (r<=Hint::NakedTriple) return Grade::Hard;
+    return Grade::Expert;
+}
+
+const char *levelName (Grade::Level l)
+{
+    static const char *names[Grade::NLevels] = { "easy", "medium", "hard", "expert", "extreme" };
+    return l>=0 && l<Grade::NLevels ? names[l] : "";
+}
+
+Grader::Grader(const Geometry& g)
+    : geom(g), N(g.N()), hints(g), solver(g), values(N), order(N)
+{
+    hint.cells.reserve(N);
+    hint.targets.reserve(N);
+}
+
+SearchStatus Grader::run (const int board[], Grade& g, Budget *budget, bool search)
+{
+    g.level = Grade::Easy;
+    g.hardest = Hint::HiddenSingle;
+    g.steps = 0;
+    g.nodes = 0;
+    g.score = 0;
+    g.solutions = 0;
+
+    hints.load(board);
+    while (hints.next(hint))
+    {
+        if (hint.error())
+            return NotFound;
+        if (hint.rule > g.hardest)
+            g.hardest = hint.rule;
+        g.steps++;
+        g.score += weights[hint.rule];
+        hints.apply(hint);
+    }
+    g.level = levelOf(g.hardest);
+
+    int filled = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        values[i] = hints.value(i);
+        filled += values[i]!=0;
+    }
+    if (filled==N) // every step was forced, so this is the only solution
+    {
+        g.solutions = 1;
+        return Found;
+    }
+    if (!search)
+        return GaveUp;
+
+    // The rules are stuck, search from where they got to
+    solver.setBudget(budget);
+    solver.load(&values[0]);
+    unsigned long long n = solver.count(2);
+    g.nodes = solver.nodesVisited();
+    solver.setBudget(0);
+    if (solver.stopped())
+        return GaveUp;
+
+    g.solutions = n;
+    if (n!=1)
+        return NotFound;
+    g.level = Grade::Extreme;
+    int bits = 0;
+    while (g.nodes>>bits)
+        bits++;
+    g.score += 100+10*bits;
+    return Found;
+}
+
+SearchStatus Grader::grade (const int board[], Grade& g, const Limits& limits)
+{
+    Budget budget(limits);
+    return run(board,g,&budget,true);
+}
+
+// Takes entries out of a full grid in random order while the puzzle
+// stays unique and no harder than wanted, g is the grade of what is left
+void Grader::takeOut (Grade::Level target, int puzzle[], Grade& g, Budget *budget)
+{
+    Grade trial;
+    for (int i = 0; i < N; ++i)
+        order[i] = i;
+    for (int i = N-1; i > 0; --i)
+        std::swap(order[i],order[rand()%(i+1)]);
+
+    run(puzzle,g,budget,false);
+    for (int k = 0; k < N && budget->check(); ++k)
+    {
+        int p = order[k], v = puzzle[p];
+        puzzle[p] = 0;
+        if (run(puzzle,trial,budget,target==Grade::Extreme)==Found && trial.level<=target)
+            g = trial;
+        else
+            puzzle[p] = v;
+    }
+}
+
+SearchStatus Grader::generate (Grade::Level target, int board[], Grade& result, const Limits& limits)
+{
+    enum { Attempts = 1000 }; // grids to try without limits before settling for less
+
+    Budget budget(limits);
+    std::vector<int> puzzle(N,0);
+    Grade current;
+    bool any = false;
+
+    for (int attempt = 0; attempt < Attempts && budget.check(); ++attempt)
+    {
+        // A random full grid
+        for (int i = 0; i < N; ++i)
+            puzzle[i] = 0;
+        solver.setRandom(true);
+        solver.setBudget(&budget);
+        solver.load(&puzzle[0]);
+        bool made = solver.solve(&puzzle[0]);
+        solver.setRandom(false);
+        solver.setBudget(0);
+        if (!made)
+            break;
+
+        takeOut(target,&puzzle[0],current,&budget);
+        if (!any || current.level > result.level)
+        {
+            for (int i = 0; i < N; ++i)
+                board[i] = puzzle[i];
+            result = current;
+            any = true;
+        }
+        if (result.level==target)
+            return Found;
+    }
+
+    if (!any)
+    {
+        for (int i = 0; i < N; ++i)
+            board[i] = 0;
+    }
+    return budget.exhausted() ? GaveUp : NotFound;
+}
+
+SearchStatus Grader::reduce (Grade::Level target, int board[], Grade& result, const Limits& limits)
+{
+    Budget budget(limits);
+    takeOut(target,board,result,&budget);
+    if (budget.exhausted())
+        return GaveUp;
+    return result.level==target ? Found : NotFound;
+}
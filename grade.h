@@ -0,0 +1,61 @@
+#ifndef GRADE_H
+#define GRADE_H
+
+#include "geometry.h"
+#include "hint.h"
+#include "solver.h"
+#include <vector>
+
+// How hard a puzzle is for a person: solved with the rules of HintEngine
+// from the easiest up, rated by the hardest rule it needed, or by the
+// size of the search once the rules get stuck.
+struct Grade
+{
+    enum Level { Easy, Medium, Hard, Expert, Extreme, NLevels };
+
+    Level level;
+    Hint::Rule hardest;       // hardest rule used
+    int steps;                // rule steps before finishing or getting stuck
+    unsigned long long nodes; // choices the search needed after the rules, 0 if none
+    int score;                // weighted steps, plus a share for the search
+    int solutions;            // 0, 1, or 2 for more than one
+};
+
+const char *levelName (Grade::Level);
+
+// Grades puzzles of one geometry, reusing its engines, so grading many
+// puzzles costs no allocations after the first.
+class Grader
+{
+private:
+    Geometry geom;
+    int N;
+    HintEngine hints;
+    Solver solver;
+    Hint hint;
+    std::vector<int> values, order;
+
+private:
+    SearchStatus run (const int[], Grade&, Budget*, bool);
+    void takeOut (Grade::Level, int[], Grade&, Budget*);
+
+public:
+    Grader(const Geometry&);
+
+    // Found with a grade when the puzzle has one solution, NotFound
+    // when it has none or several (see Grade::solutions)
+    SearchStatus grade (const int[], Grade&, const Limits& = Limits());
+
+    // Makes a puzzle of the given level: entries are taken out of a
+    // random grid one by one, each kept out only if the puzzle stays
+    // unique and no harder than wanted, so no grading pass is needed
+    // afterwards. On NotFound or GaveUp board holds the closest puzzle
+    // made, easier than wanted.
+    SearchStatus generate (Grade::Level, int[], Grade&, const Limits& = Limits());
+
+    // The same for one full grid given in board: Found when the puzzle
+    // left is of the given level, NotFound when it came out easier
+    SearchStatus reduce (Grade::Level, int[], Grade&, const Limits& = Limits());
+};
+
+#endif // GRADE_H
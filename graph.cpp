@@ -0,0 +1,160 @@
+#include "graph.h"
+#include <stddef.h>
+
+ConstraintGraph::ConstraintGraph(const Geometry& g)
+    : geom(g), N(g.N()), S(g.S()), regions(g.NSV*g.NSH), standard(true)
+{
+    int R = geom.R(), C = geom.C();
+
+    // Rows, columns and subgrids, the way Sudoku numbers them
+    unitStart.push_back(0);
+    for (int n = 0; n < R; ++n)
+    {
+        for (int i = 0; i < C; ++i)
+            unitNodes.push_back(n*C+i);
+        unitStart.push_back(unitNodes.size());
+    }
+    for (int n = 0; n < C; ++n)
+    {
+        for (int i = 0; i < R; ++i)
+            unitNodes.push_back(i*C+n);
+        unitStart.push_back(unitNodes.size());
+    }
+    for (int n = 0; n < regions; ++n)
+    {
+        int a = (n/geom.NSH)*geom.SR;
+        int b = (n%geom.NSH)*geom.SC;
+        for (int i = 0; i < S; ++i)
+            unitNodes.push_back((a+i/geom.SC)*C+b+i%geom.SC);
+        unitStart.push_back(unitNodes.size());
+    }
+    link();
+}
+
+void ConstraintGraph::link () // units of each node and peers from the units
+{
+    int U = units();
+    std::vector<int> count(N+1,0);
+    for (size_t i = 0; i < unitNodes.size(); ++i)
+        count[unitNodes[i]+1]++;
+    memberStart.assign(N+1,0);
+    for (int n = 0; n < N; ++n)
+        memberStart[n+1] = memberStart[n]+count[n+1];
+    members.assign(unitNodes.size(),0);
+    std::vector<int> fill(memberStart.begin(),memberStart.end()-1);
+    for (int u = 0; u < U; ++u)
+        for (int i = unitStart[u]; i < unitStart[u+1]; ++i)
+            members[fill[unitNodes[i]]++] = u;
+
+    // Peers of each node, every node sharing a unit with it once
+    std::vector<int> mark(N,-1);
+    peerStart.assign(1,0);
+    peers.clear();
+    for (int n = 0; n < N; ++n)
+    {
+        mark[n] = n;
+        for (const int *u = unitsBegin(n); u != unitsEnd(n); ++u)
+        {
+            for (const int *p = unitBegin(*u); p != unitEnd(*u); ++p)
+            {
+                if (mark[*p]!=n)
+                {
+                    mark[*p] = n;
+                    peers.push_back(*p);
+                }
+            }
+        }
+        peerStart.push_back(peers.size());
+    }
+}
+
+bool ConstraintGraph::setRegions (const int region[])
+{
+    std::vector<int> size(S,0);
+    for (int n = 0; n < N; ++n)
+    {
+        if (region[n]<0 || region[n]>=S)
+            return false;
+        size[region[n]]++;
+    }
+    for (int r = 0; r < S; ++r)
+    {
+        if (size[r]!=S)
+            return false;
+    }
+
+    // Rows and columns, the regions, then whatever was added after the old ones
+    int first = geom.R()+geom.C();
+    std::vector<int> start(unitStart.begin(),unitStart.begin()+first+1);
+    std::vector<int> nodes(unitNodes.begin(),unitNodes.begin()+start.back());
+    for (int r = 0; r < S; ++r)
+    {
+        for (int n = 0; n < N; ++n)
+            if (region[n]==r)
+                nodes.push_back(n);
+        start.push_back(nodes.size());
+    }
+    for (int u = first+regions; u < units(); ++u)
+    {
+        nodes.insert(nodes.end(),unitBegin(u),unitEnd(u));
+        start.push_back(nodes.size());
+    }
+
+    unitStart.swap(start);
+    unitNodes.swap(nodes);
+    regions = S;
+    standard = false;
+    link();
+    return true;
+}
+
+bool ConstraintGraph::addUnit (const std::vector<int>& unit)
+{
+    if (unit.empty() || (int)unit.size()>S)
+        return false;
+    std::vector<bool> seen(N,false);
+    for (size_t i = 0; i < unit.size(); ++i)
+    {
+        if (unit[i]<0 || unit[i]>=N || seen[unit[i]])
+            return false;
+        seen[unit[i]] = true;
+    }
+
+    unitNodes.insert(unitNodes.end(),unit.begin(),unit.end());
+    unitStart.push_back(unitNodes.size());
+    standard = false;
+    link();
+    return true;
+}
+
+bool ConstraintGraph::addDiagonals ()
+{
+    int C = geom.C();
+    if (geom.R()!=S || C!=S)
+        return false;
+
+    std::vector<int> down, up;
+    for (int i = 0; i < S; ++i)
+    {
+        down.push_back(i*C+i);
+        up.push_back(i*C+C-1-i);
+    }
+    return addUnit(down) && addUnit(up);
+}
+
+bool ConstraintGraph::addWindows ()
+{
+    int R = geom.R(), C = geom.C();
+    bool any = false;
+    for (int a = 1; a+geom.SR < R; a += geom.SR+1)
+    {
+        for (int b = 1; b+geom.SC < C; b += geom.SC+1)
+        {
+            std::vector<int> window;
+            for (int i = 0; i < S; ++i)
+                window.push_back((a+i/geom.SC)*C+b+i%geom.SC);
+            any = addUnit(window) || any;
+        }
+    }
+    return any;
+}
@@ -0,0 +1,53 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include "geometry.h"
+#include <vector>
+
+// Which nodes must differ: units (groups of nodes holding different
+// values) and, derived from them, the peers of every node, both as flat
+// lists where entries i run from start[i] to start[i+1]. Built for a
+// geometry it holds the rows, columns and subgrids of the classic board;
+// variants swap the subgrids for irregular regions (jigsaw) or add units
+// of their own (diagonals, windoku windows). The solver only sees the
+// lists, so every variant gets the same propagation and search.
+class ConstraintGraph
+{
+private:
+    Geometry geom;
+    int N, S;
+    std::vector<int> unitStart, unitNodes;
+    std::vector<int> memberStart, members; // units of each node
+    std::vector<int> peerStart, peers;
+    int regions;   // units after the rows and columns from the subgrids or the region map
+    bool standard; // nothing changed since built
+
+private:
+    void link ();
+
+public:
+    ConstraintGraph(const Geometry&);
+
+    // Replaces the subgrids by regions, one number per node from 0 up to
+    // S-1. Returns false, changing nothing, unless every region has S nodes.
+    bool setRegions (const int[]);
+    bool addDiagonals ();  // both long diagonals, boards with R==C==S only
+    bool addWindows ();    // windoku: subgrid sized windows one node apart, false if none fit
+    bool addUnit (const std::vector<int>&); // any other nodes that must differ, S at most
+
+    const Geometry& geometry () const { return geom; }
+    bool classic () const { return standard; } // just rows, columns and subgrids
+
+    int units () const { return unitStart.size()-1; }
+    const int *unitBegin (int u) const { return &unitNodes[0]+unitStart[u]; }
+    const int *unitEnd (int u) const { return &unitNodes[0]+unitStart[u+1]; }
+    int unitSize (int u) const { return unitStart[u+1]-unitStart[u]; }
+
+    const int *unitsBegin (int n) const { return &members[0]+memberStart[n]; }
+    const int *unitsEnd (int n) const { return &members[0]+memberStart[n+1]; }
+
+    const int *peersBegin (int n) const { return &peers[0]+peerStart[n]; }
+    const int *peersEnd (int n) const { return &peers[0]+peerStart[n+1]; }
+};
+
+#endif // GRAPH_H
@@ -0,0 +1,528 @@
+#include "hint.h"
+#include "graph.h"
+#include <algorithm>
+
+static inline HintEngine::Mask bit (int v)
+{
+    return 1u<<(v-1);
+}
+
+static inline bool single (HintEngine::Mask m)
+{
+    return m && !(m & (m-1));
+}
+
+static inline int lowest (HintEngine::Mask m) // value of the lowest bit
+{
+    return __builtin_ctz(m)+1;
+}
+
+static void addOnce (std::vector<int>& list, int n)
+{
+    if (n>=0 && std::find(list.begin(),list.end(),n)==list.end())
+        list.push_back(n);
+}
+
+const char *ruleName (Hint::Rule r)
+{
+    static const char *names[Hint::NRules] = {
+        "Conflict", "No candidates", "Hidden single", "Naked single", "Pointing",
+        "Claiming", "Naked pair", "Hidden pair", "Naked triple", "X-Wing"
+    };
+    return r>=0 && r<Hint::NRules ? names[r] : "";
+}
+
+HintEngine::HintEngine(const Geometry& g)
+    : geom(g), N(g.N()), S(g.S()), R(g.R()), C(g.C()), cached(false), found(false)
+{
+    full = S>=MaxValues ? ~0u : (1u<<S)-1;
+
+    // Same groups and numbering as Solver, from the classic graph
+    ConstraintGraph units(g);
+    groupStart.push_back(0);
+    for (int u = 0; u < units.units(); ++u)
+    {
+        groupNodes.insert(groupNodes.end(),units.unitBegin(u),units.unitEnd(u));
+        groupStart.push_back(groupNodes.size());
+    }
+    G = groupStart.size()-1;
+
+    groupsOf.resize(3*N);
+    for (int g = 0; g < G; ++g)
+    {
+        int k = g<R ? 0 : g<R+C ? 1 : 2;
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+            groupsOf[3*groupNodes[i]+k] = g;
+    }
+
+    values.assign(N,0);
+    used.assign(G,0);
+    crossed.assign(N,0);
+    last.cells.reserve(N);
+    last.targets.reserve(N);
+}
+
+///////////////// ** Board ** //////////////////
+
+void HintEngine::rescan (int g)
+{
+    Mask m = 0;
+    for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+    {
+        int v = values[groupNodes[i]];
+        if (v)
+            m |= bit(v);
+    }
+    used[g] = m;
+}
+
+void HintEngine::load (const int board[])
+{
+    for (int i = 0; i < N; ++i)
+    {
+        int v = board[i]<0 ? -board[i] : board[i];
+        values[i] = fits(v) ? v : 0;
+    }
+    for (int g = 0; g < G; ++g)
+        rescan(g);
+    crossed.assign(N,0);
+    cached = false;
+}
+
+void HintEngine::setValue (int n, int v) // only the three groups of n change
+{
+    if (values[n]==v || !fits(v))
+        return;
+    if (values[n])
+        crossed.assign(N,0);
+    values[n] = v;
+    for (int k = 0; k < 3; ++k)
+        rescan(groupsOf[3*n+k]);
+    cached = false;
+}
+
+HintEngine::Mask HintEngine::candidates (int n) const
+{
+    if (values[n])
+        return bit(values[n]);
+    const int *g = &groupsOf[3*n];
+    return full & ~(used[g[0]] | used[g[1]] | used[g[2]]) & ~crossed[n];
+}
+
+int HintEngine::blocker (int n, int v) const // a peer of n holding v, -1 if none
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        int g = groupsOf[3*n+k];
+        if (!(used[g] & bit(v)))
+            continue;
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+            if (values[groupNodes[i]]==v && groupNodes[i]!=n)
+                return groupNodes[i];
+    }
+    return -1;
+}
+
+bool HintEngine::crossOut (Hint& h, Hint::Rule rule, Mask m) const
+{
+    if (h.targets.empty())
+        return false;
+    h.rule = rule;
+    h.node = -1;
+    h.values = m;
+    h.value = lowest(m);
+    return true;
+}
+
+///////////////// ** Rules ** //////////////////
+
+bool HintEngine::findConflict (Hint& h) const
+{
+    h.targets.clear();
+    h.values = 0;
+    h.node = -1;
+
+    for (int g = 0; g < G; ++g) // the same value twice in a group
+    {
+        Mask seen = 0;
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+        {
+            int n = groupNodes[i], v = values[n];
+            if (!v)
+                continue;
+            if (seen & bit(v))
+            {
+                h.rule = Hint::Conflict;
+                h.value = v;
+                h.cells.clear();
+                for (int j = groupStart[g]; j <= i; ++j)
+                    if (values[groupNodes[j]]==v)
+                        h.cells.push_back(groupNodes[j]);
+                return true;
+            }
+            seen |= bit(v);
+        }
+    }
+
+    for (int n = 0; n < N; ++n) // an empty node nothing fits in
+    {
+        if (!values[n] && !candidates(n))
+        {
+            h.rule = Hint::NoCandidates;
+            h.value = 0;
+            h.cells.assign(1,n);
+            return true;
+        }
+    }
+
+    for (int g = 0; g < G; ++g) // a value with no place left in its group
+    {
+        if (!fullGroup(g))
+            continue;
+        Mask fits = used[g];
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+            fits |= candidates(groupNodes[i]);
+        if (fits!=full)
+        {
+            h.rule = Hint::NoCandidates;
+            h.value = lowest(full & ~fits);
+            h.cells.assign(groupNodes.begin()+groupStart[g],groupNodes.begin()+groupStart[g+1]);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HintEngine::findSingle (Hint& h) const
+{
+    h.targets.clear();
+    h.cells.clear();
+
+    for (int g = 0; g < G; ++g) // a value that fits only one node of a group
+    {
+        if (!fullGroup(g))
+            continue;
+        Mask once = 0, twice = 0;
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+        {
+            int n = groupNodes[i];
+            if (values[n])
+                continue;
+            Mask m = candidates(n);
+            twice |= once & m;
+            once |= m;
+        }
+        Mask hidden = once & ~twice & ~used[g];
+        if (!hidden)
+            continue;
+
+        int v = lowest(hidden);
+        h.rule = Hint::HiddenSingle;
+        h.value = v;
+        h.values = bit(v);
+        for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+        {
+            int n = groupNodes[i];
+            if (values[n])
+                continue;
+            if (candidates(n) & bit(v))
+                h.node = n;
+            else
+                addOnce(h.cells,blocker(n,v));
+        }
+        return true;
+    }
+
+    for (int n = 0; n < N; ++n) // a node with one value left
+    {
+        if (values[n] || !single(candidates(n)))
+            continue;
+        h.rule = Hint::NakedSingle;
+        h.node = n;
+        h.values = candidates(n);
+        h.value = lowest(h.values);
+        for (int v = 1; v <= S; ++v)
+            if (v!=h.value)
+                addOnce(h.cells,blocker(n,v));
+        return true;
+    }
+    return false;
+}
+
+bool HintEngine::findLocked (Hint& h) const
+{
+    // Pointing: in a subgrid, a value only fits along one row or column,
+    // so the rest of that line can't have it
+    for (int b = R+C; b < G; ++b)
+    {
+        for (int v = 1; v <= S; ++v)
+        {
+            if (used[b] & bit(v))
+                continue;
+            h.cells.clear();
+            for (int i = groupStart[b]; i < groupStart[b+1]; ++i)
+                if (!values[groupNodes[i]] && (candidates(groupNodes[i]) & bit(v)))
+                    h.cells.push_back(groupNodes[i]);
+            if (h.cells.empty())
+                continue;
+
+            for (int k = 0; k < 2; ++k)
+            {
+                int line = groupsOf[3*h.cells[0]+k];
+                bool along = true;
+                for (size_t j = 1; j < h.cells.size() && along; ++j)
+                    along = groupsOf[3*h.cells[j]+k]==line;
+                if (!along)
+                    continue;
+
+                h.targets.clear();
+                for (int i = groupStart[line]; i < groupStart[line+1]; ++i)
+                {
+                    int n = groupNodes[i];
+                    if (groupsOf[3*n+2]!=b && !values[n] && (candidates(n) & bit(v)))
+                        h.targets.push_back(n);
+                }
+                if (crossOut(h,Hint::Pointing,bit(v)))
+                    return true;
+            }
+        }
+    }
+
+    // Claiming: in a row or column, a value only fits inside one subgrid,
+    // so the rest of that subgrid can't have it
+    for (int line = 0; line < R+C; ++line)
+    {
+        if (!fullGroup(line))
+            continue;
+        int k = line<R ? 0 : 1;
+        for (int v = 1; v <= S; ++v)
+        {
+            if (used[line] & bit(v))
+                continue;
+            h.cells.clear();
+            for (int i = groupStart[line]; i < groupStart[line+1]; ++i)
+                if (!values[groupNodes[i]] && (candidates(groupNodes[i]) & bit(v)))
+                    h.cells.push_back(groupNodes[i]);
+            if (h.cells.empty())
+                continue;
+
+            int b = groupsOf[3*h.cells[0]+2];
+            bool inside = true;
+            for (size_t j = 1; j < h.cells.size() && inside; ++j)
+                inside = groupsOf[3*h.cells[j]+2]==b;
+            if (!inside)
+                continue;
+
+            h.targets.clear();
+            for (int i = groupStart[b]; i < groupStart[b+1]; ++i)
+            {
+                int n = groupNodes[i];
+                if (groupsOf[3*n+k]!=line && !values[n] && (candidates(n) & bit(v)))
+                    h.targets.push_back(n);
+            }
+            if (crossOut(h,Hint::Claiming,bit(v)))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool HintEngine::findSubset (Hint& h) const
+{
+    int open[MaxValues];
+    Mask cand[MaxValues];
+
+    // Naked pairs, then hidden pairs, then naked triples, over all groups
+    for (int rule = Hint::NakedPair; rule <= Hint::NakedTriple; ++rule)
+    {
+        for (int g = 0; g < G; ++g)
+        {
+            if (!fullGroup(g))
+                continue;
+            int k = 0;
+            for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+            {
+                int n = groupNodes[i];
+                if (!values[n])
+                {
+                    open[k] = n;
+                    cand[k++] = candidates(n);
+                }
+            }
+
+            if (rule==Hint::NakedPair) // two nodes sharing the same two values
+            {
+                for (int a = 0; a < k; ++a)
+                {
+                    if (__builtin_popcount(cand[a])!=2)
+                        continue;
+                    for (int b = a+1; b < k; ++b)
+                    {
+                        if (cand[b]!=cand[a])
+                            continue;
+                        h.targets.clear();
+                        for (int i = 0; i < k; ++i)
+                            if (i!=a && i!=b && (cand[i] & cand[a]))
+                                h.targets.push_back(open[i]);
+                        h.cells.clear();
+                        h.cells.push_back(open[a]);
+                        h.cells.push_back(open[b]);
+                        if (crossOut(h,Hint::NakedPair,cand[a]))
+                            return true;
+                    }
+                }
+            }
+            else if (rule==Hint::HiddenPair) // two values that only fit the same two nodes
+            {
+                Mask where[MaxValues];
+                for (int v = 1; v <= S; ++v)
+                {
+                    where[v-1] = 0;
+                    for (int i = 0; i < k; ++i)
+                        if (cand[i] & bit(v))
+                            where[v-1] |= 1u<<i;
+                }
+                for (int v = 1; v <= S; ++v)
+                {
+                    if (__builtin_popcount(where[v-1])!=2)
+                        continue;
+                    for (int w = v+1; w <= S; ++w)
+                    {
+                        if (where[w-1]!=where[v-1])
+                            continue;
+                        Mask pair = bit(v) | bit(w), extra = 0;
+                        h.targets.clear();
+                        h.cells.clear();
+                        for (int i = 0; i < k; ++i)
+                        {
+                            if (!(where[v-1] & (1u<<i)))
+                                continue;
+                            h.cells.push_back(open[i]);
+                            if (cand[i] & ~pair)
+                            {
+                                extra |= cand[i] & ~pair;
+                                h.targets.push_back(open[i]);
+                            }
+                        }
+                        if (crossOut(h,Hint::HiddenPair,extra))
+                            return true;
+                    }
+                }
+            }
+            else // three nodes with only three values between them
+            {
+                for (int a = 0; a < k; ++a)
+                {
+                    if (__builtin_popcount(cand[a])>3)
+                        continue;
+                    for (int b = a+1; b < k; ++b)
+                    {
+                        if (__builtin_popcount(cand[a] | cand[b])>3)
+                            continue;
+                        for (int c = b+1; c < k; ++c)
+                        {
+                            Mask three = cand[a] | cand[b] | cand[c];
+                            if (__builtin_popcount(three)!=3)
+                                continue;
+                            h.targets.clear();
+                            for (int i = 0; i < k; ++i)
+                                if (i!=a && i!=b && i!=c && (cand[i] & three))
+                                    h.targets.push_back(open[i]);
+                            h.cells.clear();
+                            h.cells.push_back(open[a]);
+                            h.cells.push_back(open[b]);
+                            h.cells.push_back(open[c]);
+                            if (crossOut(h,Hint::NakedTriple,three))
+                                return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool HintEngine::findXWing (Hint& h) const
+{
+    // A value that fits only the same two columns of two rows must be in
+    // those columns there, and nowhere else in them. Same with rows and
+    // columns swapped.
+    for (int k = 0; k < 2; ++k)
+    {
+        int first = k==0 ? 0 : R, lines = k==0 ? R : C;
+        for (int v = 1; v <= S; ++v)
+        {
+            Mask where[64];
+            for (int l = 0; l < lines; ++l)
+            {
+                int g = first+l;
+                where[l] = 0;
+                if (!fullGroup(g) || (used[g] & bit(v)))
+                    continue;
+                for (int i = groupStart[g]; i < groupStart[g+1]; ++i)
+                    if (!values[groupNodes[i]] && (candidates(groupNodes[i]) & bit(v)))
+                        where[l] |= 1u<<(i-groupStart[g]);
+            }
+
+            for (int a = 0; a < lines; ++a)
+            {
+                if (__builtin_popcount(where[a])!=2)
+                    continue;
+                for (int b = a+1; b < lines; ++b)
+                {
+                    if (where[b]!=where[a])
+                        continue;
+                    h.targets.clear();
+                    h.cells.clear();
+                    for (Mask m = where[a]; m; m &= m-1)
+                    {
+                        int p = __builtin_ctz(m);
+                        int across = k==0 ? R+p : p; // the crossing column (or row)
+                        for (int i = groupStart[across]; i < groupStart[across+1]; ++i)
+                        {
+                            int n = groupNodes[i];
+                            int l = groupsOf[3*n+k]-first;
+                            if (l==a || l==b)
+                                h.cells.push_back(n);
+                            else if (!values[n] && (candidates(n) & bit(v)))
+                                h.targets.push_back(n);
+                        }
+                    }
+                    if (crossOut(h,Hint::XWing,bit(v)))
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+///////////////// ** Hints ** //////////////////
+
+bool HintEngine::next (Hint& h)
+{
+    if (!cached)
+    {
+        // The rules keep a Mask per value and per node of a group
+        found = S<=MaxValues && (findConflict(last) || findSingle(last) || findLocked(last)
+             || findSubset(last) || (R<=64 && C<=64 && findXWing(last)));
+        cached = true;
+    }
+    h = last;
+    return found;
+}
+
+void HintEngine::apply (const Hint& h)
+{
+    if (h.error())
+        return;
+    if (h.placement())
+    {
+        setValue(h.node,h.value);
+        return;
+    }
+    for (size_t i = 0; i < h.targets.size(); ++i)
+        crossed[h.targets[i]] |= h.values;
+    cached = false;
+}
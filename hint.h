@@ -0,0 +1,91 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include "geometry.h"
+#include <vector>
+
+// One step a player could take next: a value that must go in a node, or
+// candidates that can be crossed out, with the rule that shows it.
+// Rules are in order of difficulty, Conflict and NoCandidates report a
+// board that is already wrong.
+struct Hint
+{
+    enum Rule { Conflict, NoCandidates, HiddenSingle, NakedSingle, Pointing, Claiming,
+                NakedPair, HiddenPair, NakedTriple, XWing, NRules };
+
+    Rule rule;
+    int node;                 // placements: where the value goes, otherwise -1
+    int value;                // the value placed or crossed out (lowest one for pairs)
+    unsigned values;          // eliminations: the values crossed out, bit v-1 for v
+    std::vector<int> targets; // eliminations: nodes losing them
+    std::vector<int> cells;   // nodes the rule looks at
+
+    bool placement () const { return rule==HiddenSingle || rule==NakedSingle; }
+    bool error () const { return rule==Conflict || rule==NoCandidates; }
+};
+
+const char *ruleName (Hint::Rule);
+
+// Finds hints on a board without searching. Candidates are worked out
+// from the values in each row, column and subgrid, which are kept up to
+// date one edit at a time, minus what earlier elimination hints crossed
+// out. The rules are tried from the easiest, and the hint found is kept
+// until the board changes, so asking again costs nothing.
+class HintEngine
+{
+public:
+    typedef unsigned int Mask;
+    enum { MaxValues = 32 }; // bits in a Mask, bigger boards get no hints
+
+private:
+    Geometry geom;
+    int N, S, R, C, G;
+    Mask full;
+
+    std::vector<int> groupStart, groupNodes; // rows, then columns, then subgrids
+    std::vector<int> groupsOf;               // 3 per node
+    std::vector<int> values;
+    std::vector<Mask> used;                  // values present in each group
+    std::vector<Mask> crossed;               // candidates crossed out by hints
+
+    Hint last;
+    bool cached;
+    bool found;
+
+private:
+    void rescan (int);
+    int blocker (int,int) const;
+    bool fullGroup (int g) const { return groupStart[g+1]-groupStart[g]==S; }
+    bool fits (int v) const { return v>=0 && v<=S && v<=MaxValues; }
+
+    bool findConflict (Hint&) const;
+    bool findSingle (Hint&) const;
+    bool findLocked (Hint&) const;
+    bool findSubset (Hint&) const;
+    bool findXWing (Hint&) const;
+    bool crossOut (Hint&, Hint::Rule, Mask) const;
+
+public:
+    HintEngine(const Geometry&);
+
+    const Geometry& geometry () const { return geom; }
+
+    // Takes a whole board (0 empty, signs ignored), forgetting crossed out candidates
+    void load (const int[]);
+
+    // One edit, 0 empties the node. Emptying or changing a node also
+    // forgets crossed out candidates, since they may have relied on it.
+    void setValue (int,int);
+    int value (int n) const { return values[n]; }
+
+    Mask candidates (int) const;
+
+    // The next step from the current board, false if none of the rules
+    // gets any further (only guessing would)
+    bool next (Hint&);
+
+    // Places the value or crosses out the candidates of a hint
+    void apply (const Hint&);
+};
+
+#endif // HINT_H
@@ -0,0 +1,126 @@
+#include "csudoku.h"
+#include "grade.h"
+#include "solver.h"
+#include <new>
+#include <vector>
+
+struct sudoku_solver
+{
+    Solver solver;
+    Grader grader;
+    std::vector<int> board;  // scratch in the solver's own size, so calls allocate nothing
+    Limits limits;
+    uint64_t nodes;
+
+    sudoku_solver(const Geometry& g) : solver(g), grader(g), board(g.N()), nodes(0) {}
+};
+
+sudoku_solver *sudoku_solver_new (const sudoku_geometry *g)
+{
+    if (!g || g->sr<1 || g->sc<1 || g->nsv<1 || g->nsh<1 || g->sr*g->sc > Solver::MaxValues)
+        return 0;
+    return new (std::nothrow) sudoku_solver(Geometry(g->sr,g->sc,g->nsv,g->nsh));
+}
+
+void sudoku_solver_free (sudoku_solver *s)
+{
+    delete s;
+}
+
+int sudoku_nodes (const sudoku_solver *s)
+{
+    return s->board.size();
+}
+
+void sudoku_set_limits (sudoku_solver *s, double seconds, uint64_t max_nodes)
+{
+    s->limits = Limits(seconds,max_nodes);
+}
+
+uint64_t sudoku_last_nodes (const sudoku_solver *s)
+{
+    return s->nodes;
+}
+
+static bool load (sudoku_solver *s, const uint8_t *in)
+{
+    int N = s->board.size();
+    for (int i = 0; i < N; ++i)
+        s->board[i] = in[i];
+    return s->solver.load(&s->board[0]);
+}
+
+int sudoku_solve (sudoku_solver *s, const uint8_t *in, uint8_t *out, unsigned flags)
+{
+    Budget budget(s->limits);
+    Solver& solver = s->solver;
+    solver.setRandom(flags & SUDOKU_RANDOM);
+    solver.setBudget(&budget);
+
+    int status;
+    if (!load(s,in))
+        status = SUDOKU_BAD_INPUT;
+    else if (!solver.next(&s->board[0]))
+        status = solver.stopped() ? SUDOKU_GAVE_UP : SUDOKU_NO_SOLUTION;
+    else
+    {
+        int N = s->board.size();
+        for (int i = 0; i < N; ++i)
+            out[i] = s->board[i];
+        status = SUDOKU_OK;
+        if ((flags & SUDOKU_UNIQUE) && solver.next(0))
+            status = SUDOKU_MULTIPLE;
+        else if (solver.stopped())
+            status = SUDOKU_GAVE_UP;
+    }
+
+    s->nodes = solver.nodesVisited();
+    solver.setBudget(0);
+    return status;
+}
+
+int sudoku_count (sudoku_solver *s, const uint8_t *in, uint64_t limit, uint64_t *count)
+{
+    Budget budget(s->limits);
+    Solver& solver = s->solver;
+    solver.setRandom(false);
+    solver.setBudget(&budget);
+
+    int status = SUDOKU_BAD_INPUT;
+    *count = 0;
+    if (load(s,in))
+    {
+        *count = solver.count(limit);
+        status = solver.stopped() ? SUDOKU_GAVE_UP : SUDOKU_OK;
+    }
+
+    s->nodes = solver.nodesVisited();
+    solver.setBudget(0);
+    return status;
+}
+
+int sudoku_grade_puzzle (sudoku_solver *s, const uint8_t *in, sudoku_grade *grade)
+{
+    int N = s->board.size(), S = s->solver.geometry().S();
+    for (int i = 0; i < N; ++i)
+    {
+        if (in[i]>S)
+            return SUDOKU_BAD_INPUT;
+        s->board[i] = in[i];
+    }
+
+    Grade g;
+    SearchStatus status = s->grader.grade(&s->board[0],g,s->limits);
+    s->nodes = g.nodes;
+    grade->level = g.level;
+    grade->hardest_rule = g.hardest;
+    grade->steps = g.steps;
+    grade->search_nodes = g.nodes;
+    grade->score = g.score;
+
+    if (status==GaveUp)
+        return SUDOKU_GAVE_UP;
+    if (status==NotFound)
+        return g.solutions ? SUDOKU_MULTIPLE : SUDOKU_NO_SOLUTION;
+    return SUDOKU_OK;
+}
@@ -0,0 +1,95 @@
+#ifndef CSUDOKU_H
+#define CSUDOKU_H
+
+/* C interface to the solver, for services and other languages.
+ *
+ * Boards are one byte per node, row by row, 0 for an empty node and
+ * 1..S for values (S = sr*sc). A solver is made once per geometry;
+ * sudoku_solver_new() is the only call that allocates, solving and
+ * counting work in the solver's own memory and the caller's buffers.
+ * A solver must not be used by two threads at once, make one each.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same four dimensions as the Sudoku constructors, 3 3 3 3 for 9x9 */
+typedef struct sudoku_geometry
+{
+    int sr;   /* rows in a subgrid */
+    int sc;   /* columns in a subgrid */
+    int nsv;  /* subgrids going vertically */
+    int nsh;  /* subgrids going across */
+} sudoku_geometry;
+
+typedef struct sudoku_solver sudoku_solver;
+
+enum sudoku_status
+{
+    SUDOKU_OK = 0,
+    SUDOKU_NO_SOLUTION,
+    SUDOKU_GAVE_UP,      /* ran out of time or nodes, see sudoku_set_limits() */
+    SUDOKU_BAD_INPUT,    /* a value above S */
+    SUDOKU_MULTIPLE      /* SUDOKU_UNIQUE: solved, but not the only solution */
+};
+
+enum sudoku_flags
+{
+    SUDOKU_RANDOM = 1,   /* random choices, a random solution of open boards */
+    SUDOKU_UNIQUE = 2    /* also check that the solution is the only one */
+};
+
+/* NULL if the geometry is not usable (values per group above 32) */
+sudoku_solver *sudoku_solver_new (const sudoku_geometry *g);
+void sudoku_solver_free (sudoku_solver *s);
+
+/* Node count of the solver's boards, the size of in and out */
+int sudoku_nodes (const sudoku_solver *s);
+
+/* Time in seconds and choices allowed per call, 0 for no limit */
+void sudoku_set_limits (sudoku_solver *s, double seconds, uint64_t max_nodes);
+
+/* Writes the solution of in to out (in and out may be the same buffer) */
+int sudoku_solve (sudoku_solver *s, const uint8_t *in, uint8_t *out, unsigned flags);
+
+/* Number of solutions of in, stopping at limit (0 for all). On
+ * SUDOKU_GAVE_UP *count holds the solutions found before stopping. */
+int sudoku_count (sudoku_solver *s, const uint8_t *in, uint64_t limit, uint64_t *count);
+
+/* Difficulty for a person, from easy puzzles that only need singles
+ * to extreme ones where the rules get stuck and guessing is needed */
+enum sudoku_level
+{
+    SUDOKU_EASY = 0,
+    SUDOKU_MEDIUM,
+    SUDOKU_HARD,
+    SUDOKU_EXPERT,
+    SUDOKU_EXTREME
+};
+
+typedef struct sudoku_grade
+{
+    int level;              /* a sudoku_level */
+    int hardest_rule;       /* hardest step: 2 hidden single, 3 naked single, 4 pointing,
+                               5 claiming, 6 naked pair, 7 hidden pair, 8 naked triple,
+                               9 X-Wing, as Hint::Rule in hint.h */
+    int steps;              /* rule steps taken */
+    uint64_t search_nodes;  /* choices needed after the rules got stuck */
+    int score;              /* finer grained than level, higher is harder */
+} sudoku_grade;
+
+/* Grades a puzzle; SUDOKU_NO_SOLUTION or SUDOKU_MULTIPLE if it has no
+ * single solution */
+int sudoku_grade_puzzle (sudoku_solver *s, const uint8_t *in, sudoku_grade *grade);
+
+/* Choices made by the last call */
+uint64_t sudoku_last_nodes (const sudoku_solver *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSUDOKU_H */
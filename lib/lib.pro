@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Solver library with a C interface (csudoku.h),
+# shared by default, CONFIG+=staticlib for a static one
+#
+#-------------------------------------------------
+
+CONFIG   -= qt
+
+TARGET = sudoku
+TEMPLATE = lib
+
+include(../core.pri)
+
+SOURCES += csudoku.cpp
+
+HEADERS += csudoku.h
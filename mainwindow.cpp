@@ -1,406 +1,457 @@
-#include "mainwindow.h"
-#include "sudoku.h"
-#include <time.h>
-
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
-{
-    QFrame *groupBox = new QFrame;
-    QGridLayout *mainLayout = new QGridLayout;
-    QGridLayout *layout[SubGridRows][SubGridRows];
-    QFrame *subGroupBox[SubGridRows][SubGridRows];
-
-    level = medium;
-
-    srand(time(NULL));
-    
-    // An input validator so only digits 1-9 may be entered.
-
-    QRegExp rx("[1-9]\\d{0,0}");
-    QValidator *validator = new QRegExpValidator(rx, this);
-
-    // Create QPalette here and set its Color and Color Role
-    colors[0]=Qt::darkYellow; // user input
-    colors[1]=Qt::blue; // game values
-    colors[2]=Qt::red; // conflicts
-    colors[3]=Qt::green; // computer solved
-
-    for (int i = 0;i < 4; ++i)
-    {
-        palettes[i] = new QPalette();
-        palettes[i]->setColor(QPalette::Text,colors[i]); // user input
-    }
-	
-    // Define the font to be used
-
-    QFont *font = new QFont();
-    font->setFamily("Helvetica");
-    font->setPixelSize(20);
-    QApplication::setFont(*font);
-
-    // Create the grid display with boxes to enter digits.
-
-    for (int i = 0; i < SubGridRows; ++i) {
-        for (int j = 0; j < SubGridRows; ++j) {
-            layout[i][j] = new QGridLayout;
-            subGroupBox[i][j] = new QFrame;
-            for (int k = 0; k < SubGridRows; ++k) {
-                for (int l = 0; l < SubGridRows; ++l) {
-                    int x = k+i*SubGridRows, y = l+j*SubGridRows;
-                    entries[x][y] = new QLineEdit();
-                    entries[x][y]->setAlignment(Qt::AlignCenter);
-                    entries[x][y]->setFixedSize(32,32);
-                    entries[x][y]->setValidator(validator);
-                    entries[x][y]->setPalette(*palettes[0]);
-                    entries[x][y]->setFrame(0);
-                    connect(entries[x][y], SIGNAL(textEdited(const QString&)), this, SLOT(resetEntryColor()));
-                    layout[i][j]->addWidget(entries[x][y],k,l);
-                }
-            }
-
-            layout[i][j]->setSpacing ( 0 );
-            layout[i][j]->setContentsMargins ( 0, 0, 0, 0 );
-            subGroupBox[i][j]->setLayout(layout[i][j]);
-            subGroupBox[i][j]->setFrameShape (QFrame::Box);
-
-            mainLayout->addWidget(subGroupBox[i][j],i,j);
-        }
-    }
-
-    // The solve, create, clear and reset
-
-    QPushButton *solveButton = new QPushButton(tr("Solve"));
-    QPushButton *clearButton = new QPushButton(tr("Clear"));
-    QPushButton *createButton = new QPushButton(tr("Create"));
-    QPushButton *resetButton = new QPushButton(tr("Reset"));
-    solveButton->setFlat(1);
-    clearButton->setFlat(1);
-    resetButton->setFlat(1);
-    createButton->setFlat(1);
-	
-    connect(solveButton, SIGNAL(clicked()), this, SLOT(solve()));
-    connect(clearButton, SIGNAL(clicked()), this, SLOT(clear()));
-    connect(resetButton, SIGNAL(clicked()), this, SLOT(reset()));
-    connect(createButton, SIGNAL(clicked()), this, SLOT(create()));
-
-    QHBoxLayout *buttonLayout = new QHBoxLayout;
-    buttonLayout->addWidget(createButton);
-    buttonLayout->addWidget(resetButton);
-    buttonLayout->addWidget(solveButton);
-    buttonLayout->addWidget(clearButton);
-    QFrame *buttonBox = new QFrame;
-    buttonBox->setLayout(buttonLayout);
-
-    buttonBox->setFixedSize(360,50);
-    mainLayout->addWidget(buttonBox,3,0,1,3);
-    mainLayout->setSpacing( 0 );
-    mainLayout->setContentsMargins(0,0,0,0);
-    groupBox->setLayout(mainLayout);
-	
-    this->setCentralWidget(groupBox);
-
-    openAct = new QAction(tr("&Open"), this);
-    connect(openAct, SIGNAL(triggered()), this, SLOT(open()));
-  
-    saveAct = new QAction(tr("&Save"), this);
-    saveAct->setShortcuts(QKeySequence::Save);
-    connect(saveAct, SIGNAL(triggered()), this, SLOT(save()));
-    
-    easyAct = new QAction(tr("&Easy"), this);
-    easyAct->setCheckable(true);
-    connect(easyAct, SIGNAL(triggered()), this, SLOT(setEasy()));
-
-    mediumAct = new QAction(tr("&Medium"), this);
-    mediumAct->setCheckable(true);
-    mediumAct->setChecked(1);
-    connect(mediumAct, SIGNAL(triggered()), this, SLOT(setMedium()));
-
-    hardAct = new QAction(tr("&Hard"), this);
-    hardAct->setCheckable(true);
-    connect(hardAct, SIGNAL(triggered()), this, SLOT(setHard()));
-
-    fileMenu = menuBar()->addMenu(tr("&File"));
-    fileMenu->addAction(openAct);
-    fileMenu->addAction(saveAct);
-
-    difficultyMenu = menuBar()->addMenu(tr("&Difficulty"));
-    difficultyMenu->addAction(easyAct);
-    difficultyMenu->addAction(mediumAct);
-    difficultyMenu->addAction(hardAct);
-
-#ifdef __APPLE__
-    this->setFixedSize(360,420);
-#else
-    this->setFixedSize(360,440);
-#endif
-    
-    this->setWindowTitle(tr("Sudoku Machine"));
-
-    QPalette backgPalette = this->palette();
-    backgPalette.setColor(QPalette::Window, Qt::gray);
-    this->setPalette(backgPalette);
-
-    this->setUnifiedTitleAndToolBarOnMac (true);
-
-    return;
-}
-
-void MainWindow::save()
-{
-    QString fileName = QFileDialog::getSaveFileName(this,
-                                                    tr("Save sudoku. Of mighty importance"), "",
-                                                    tr("Sudokus (*.sud);;All Files (*)"));
-    
-    if (fileName.isEmpty())
-        return;
-    else 
-    {
-        QFile file(fileName);
-        if (!file.open(QIODevice::WriteOnly)) 
-        {
-            QMessageBox::information(this, tr("Unable to open file"),
-                                     file.errorString());
-            return;
-        }
-        QTextStream out(&file);
-
-        int N = SubGridRows*SubGridRows;
-        QString state;
-        for (int i = 0; i < N; ++i) 
-        {
-            for (int j = 0; j < N; ++j) 
-            {
-                QColor c = entries[i][j]->palette().color(QPalette::Text);
-                for (int k = 0; k < 4; ++k)
-                    if (colors[k]==c)
-                    {
-                        QString s; s.setNum(k);
-                        state.append(s);
-                    }
-                if (entries[i][j]->text().length()>0)
-                    state.append(entries[i][j]->text());
-                else state.append(tr("0"));
-            }
-        }
-        
-        out << state;
-    }
-}
-
-void MainWindow::open()
-{
-    QString fileName = QFileDialog::getOpenFileName(this,
-                                                    tr("Retrieve forgotten sudoku"), "",
-                                                    tr("Sudokus (*.sud);;All Files (*)"));
-    
-    if (fileName.isEmpty())
-        return;
-    else 
-    {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly)) 
-        {
-            QMessageBox::information(this, tr("Unable to open file"),
-                                     file.errorString());
-            return;
-        }
-        QTextStream in(&file);
-       
-        int N = SubGridRows*SubGridRows;
-        QString state;
-        state = in.readLine();
-        
-        if (state.length()!=2*N*N)
-        {
-            QMessageBox::information(this, tr("Look behind you"),tr("Your file has been corrupted!"));
-            return;
-        }
-
-        this->clear();
-        
-        for (int i = 0; i < state.length(); i++)
-        {
-            QString s(state[i]);
-            int k = (i-i%2)/2;
-            entries[(k-k%N)/N][k%N]->setPalette(*palettes[s.toInt()]);
-            i++;
-            s = QString(state[i]);
-            if (s!=tr("0"))
-                entries[(k-k%N)/N][k%N]->setText(s);
-        }
-    }
-}
-
-void MainWindow::setEasy()
-{
-    level = easy;
-    mediumAct->setChecked(0);
-    hardAct->setChecked(0);
-}
-
-void MainWindow::setMedium()
-{
-    level = medium;
-    easyAct->setChecked(0);
-    hardAct->setChecked(0);
-}
-
-void MainWindow::setHard()
-{
-    level = hard;
-    easyAct->setChecked(0);
-    mediumAct->setChecked(0);
-}
-
-void MainWindow::solve()
-{
-    int N = SubGridRows*SubGridRows;
-    int grid[N*N];
-
-    // Get input from the grid
-    bool blue_nodes=false;
-    for (int i = 0; i < N; ++i)
-    {
-        for (int j = 0; j < N; ++j)
-        {
-            if (entries[i][j]->palette().color(QPalette::Text)==colors[1])
-            {
-                grid[j+i*N] = -entries[i][j]->text().toInt();
-                blue_nodes = true;
-            }
-            else 
-            {
-                grid[j+i*N] = entries[i][j]->text().toInt();               
-            }
-        }
-    }
-
-    // Create sudoku object and solve the shit out of it
-
-    Sudoku sud(SubGridRows,SubGridRows,SubGridRows,SubGridRows,grid);
-    sud.findBadNodes();
-
-    if ( sud.Solve() ) // if solution exists
-    {
-        for (int i = 0; i < N; ++i)
-        { // Enter solution on the grid
-            for (int j = 0; j < N; ++j)
-            {
-                if (grid[j+i*N]==0)
-                    entries[i][j]->setPalette(*palettes[3]);
-
-                QString *str = new QString();
-                str->setNum(*sud.GetNode(i,j).begin());
-                entries[i][j]->setText(*str);
-            }
-        }
-    } 
-    else if (blue_nodes) // if it doesn't, highlight what went wrong if there
-    {                    // was a sudoku board given
-        int g[N*N];
-        for (int i = 0; i < N; ++i)
-        {
-            for (int j = 0; j < N; ++j)
-            {
-                if (grid[j+i*N]<0)
-                {
-                    grid[j+i*N] *= -1;
-                    g[j+i*N] = grid[j+i*N];
-                }
-                else
-                {
-                    g[j+i*N] = 0;
-                }
-            }
-        }
-        Sudoku origSud(SubGridRows,SubGridRows,SubGridRows,SubGridRows,g);
-        origSud.Solve();
-        for (int i = 0; i < N; ++i)
-        {
-            for (int j = 0; j < N; ++j)
-            {
-                if (*origSud.GetNode(i,j).begin()!=grid[i*N+j])
-                {
-                    entries[i][j]->setPalette(*palettes[2]);
-                }
-            }
-        }
-    }
-    else // user given sudoku is bad
-    {
-        std::set<int> bad = sud.badNodes();
-        std::set<int>::const_iterator it;
-        for (it=bad.begin(); it!=bad.end(); ++it)
-        {
-            int n = *it;
-            entries[(n-n%N)/N][n%N]->setPalette(*palettes[2]);
-        }
-    }
-}
-
-void MainWindow::clear() // clears the grid completely
-{
-    int N = SubGridRows*SubGridRows;
-    for (int i = 0; i < N; ++i)
-    {
-        for (int j = 0; j < N; ++j)
-        {
-            entries[i][j]->clear();
-            entries[i][j]->setPalette(*palettes[0]);
-        }
-    }
-}
-
-void MainWindow::resetEntryColor() // resets entry text color to default
-{
-    QPushButton* entry = (QPushButton*) QObject::sender();
-    entry->setPalette(*palettes[0]);
-}
-	
-void MainWindow::reset() // reset all entries which are not blue, i.e. not given numbers
-{
-    int N = SubGridRows*SubGridRows;
-    for (int i = 0; i < N; ++i)
-    {
-        for (int j = 0; j < N; ++j)
-        {
-            QColor c = entries[i][j]->palette().color(QPalette::Text);
-            if (c!=colors[1])
-            {
-                entries[i][j]->clear();
-                entries[i][j]->setPalette(*palettes[0]);
-            }
-        }
-    }
-}
-
-void MainWindow::create() // generates random sudoku puzzle with unique solution
-{
-    Sudoku sud(SubGridRows,SubGridRows,SubGridRows,SubGridRows);
-    sud.generateGrid(level+rand()%5);
-
-    int N = SubGridRows*SubGridRows;
-
-    // Enter sudoku on the grid
-    for (int i = 0; i < N; ++i)
-    {
-        for (int j = 0; j < N; ++j)
-        {
-            if (sud.GetNode(i,j).size()==1)
-            {
-                QString *str = new QString();
-                str->setNum(*sud.GetNode(i,j).begin());
-                entries[i][j]->setText(*str);
-                entries[i][j]->setPalette(*palettes[1]);
-            }
-            else
-            {
-                entries[i][j]->clear();
-            }
-        }
-    }
-}
-
-MainWindow::~MainWindow()
-{
-}
+#include "mainwindow.h"
+#include "board.h"
+#include "geometry.h"
+#include "grade.h"
+#include "hint.h"
+#include "puzzledb.h"
+#include "solver.h"
+#include <limits.h>
+#include <time.h>
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+{
+    QFrame *groupBox = new QFrame;
+    QGridLayout *mainLayout = new QGridLayout;
+
+    level = Grade::Medium;
+    hints = 0;
+    solver = 0;
+
+    srand(time(NULL));
+
+    // Define the font to be used
+
+    QFont *font = new QFont();
+    font->setFamily("Helvetica");
+    font->setPixelSize(20);
+    QApplication::setFont(*font);
+
+    // The board paints every node itself and takes digits from the keyboard.
+
+    board = new BoardWidget;
+    mainLayout->addWidget(board,0,0,Qt::AlignCenter);
+
+    // The solve, hint, create, clear and reset
+
+    QPushButton *solveButton = new QPushButton(tr("Solve"));
+    QPushButton *hintButton = new QPushButton(tr("Hint"));
+    QPushButton *clearButton = new QPushButton(tr("Clear"));
+    QPushButton *createButton = new QPushButton(tr("Create"));
+    QPushButton *resetButton = new QPushButton(tr("Reset"));
+    solveButton->setFlat(1);
+    hintButton->setFlat(1);
+    clearButton->setFlat(1);
+    resetButton->setFlat(1);
+    createButton->setFlat(1);
+	
+    connect(solveButton, SIGNAL(clicked()), this, SLOT(solve()));
+    connect(hintButton, SIGNAL(clicked()), this, SLOT(hint()));
+    connect(clearButton, SIGNAL(clicked()), this, SLOT(clear()));
+    connect(resetButton, SIGNAL(clicked()), this, SLOT(reset()));
+    connect(createButton, SIGNAL(clicked()), this, SLOT(create()));
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget(createButton);
+    buttonLayout->addWidget(resetButton);
+    buttonLayout->addWidget(hintButton);
+    buttonLayout->addWidget(solveButton);
+    buttonLayout->addWidget(clearButton);
+    QFrame *buttonBox = new QFrame;
+    buttonBox->setLayout(buttonLayout);
+
+    buttonBox->setFixedHeight(50);
+    mainLayout->addWidget(buttonBox,1,0);
+    mainLayout->setSpacing( 0 );
+    mainLayout->setContentsMargins(0,0,0,0);
+    groupBox->setLayout(mainLayout);
+	
+    this->setCentralWidget(groupBox);
+
+    openAct = new QAction(tr("&Open"), this);
+    connect(openAct, SIGNAL(triggered()), this, SLOT(open()));
+  
+    saveAct = new QAction(tr("&Save"), this);
+    saveAct->setShortcuts(QKeySequence::Save);
+    connect(saveAct, SIGNAL(triggered()), this, SLOT(save()));
+    
+    easyAct = new QAction(tr("&Easy"), this);
+    easyAct->setCheckable(true);
+    connect(easyAct, SIGNAL(triggered()), this, SLOT(setEasy()));
+
+    mediumAct = new QAction(tr("&Medium"), this);
+    mediumAct->setCheckable(true);
+    mediumAct->setChecked(1);
+    connect(mediumAct, SIGNAL(triggered()), this, SLOT(setMedium()));
+
+    hardAct = new QAction(tr("&Hard"), this);
+    hardAct->setCheckable(true);
+    connect(hardAct, SIGNAL(triggered()), this, SLOT(setHard()));
+
+    size3Act = new QAction(tr("&9x9"), this);
+    size3Act->setCheckable(true);
+    size3Act->setChecked(1);
+    connect(size3Act, SIGNAL(triggered()), this, SLOT(setSize3()));
+
+    size4Act = new QAction(tr("&16x16"), this);
+    size4Act->setCheckable(true);
+    connect(size4Act, SIGNAL(triggered()), this, SLOT(setSize4()));
+
+    size5Act = new QAction(tr("&25x25"), this);
+    size5Act->setCheckable(true);
+    connect(size5Act, SIGNAL(triggered()), this, SLOT(setSize5()));
+
+    fileMenu = menuBar()->addMenu(tr("&File"));
+    fileMenu->addAction(openAct);
+    fileMenu->addAction(saveAct);
+
+    difficultyMenu = menuBar()->addMenu(tr("&Difficulty"));
+    difficultyMenu->addAction(easyAct);
+    difficultyMenu->addAction(mediumAct);
+    difficultyMenu->addAction(hardAct);
+
+    sizeMenu = menuBar()->addMenu(tr("Si&ze"));
+    sizeMenu->addAction(size3Act);
+    sizeMenu->addAction(size4Act);
+    sizeMenu->addAction(size5Act);
+
+    // The window follows the size of the board
+    this->layout()->setSizeConstraint(QLayout::SetFixedSize);
+    
+    this->setWindowTitle(tr("Sudoku Machine"));
+
+    QPalette backgPalette = this->palette();
+    backgPalette.setColor(QPalette::Window, Qt::gray);
+    this->setPalette(backgPalette);
+
+    this->setUnifiedTitleAndToolBarOnMac (true);
+
+    return;
+}
+
+void MainWindow::save()
+{
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    tr("Save sudoku. Of mighty importance"), "",
+                                                    tr("Sudokus (*.sud);;All Files (*)"));
+    
+    if (fileName.isEmpty())
+        return;
+    else 
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) 
+        {
+            QMessageBox::information(this, tr("Unable to open file"),
+                                     file.errorString());
+            return;
+        }
+        QTextStream out(&file);
+
+        // Two characters per node, its kind and its value
+        int N = board->nodes();
+        QString state;
+        for (int i = 0; i < N; ++i) 
+        {
+            state.append(QChar('0'+board->kind(i)));
+            state.append(QChar(symbolChar(board->value(i))));
+        }
+        
+        out << state;
+    }
+}
+
+void MainWindow::open()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                    tr("Retrieve forgotten sudoku"), "",
+                                                    tr("Sudokus (*.sud);;Puzzle packs (*.sdb);;All Files (*)"));
+    
+    if (fileName.isEmpty())
+        return;
+
+    PuzzleDb db;
+    if (db.open(QFile::encodeName(fileName).constData())) // a binary puzzle pack
+    {
+        const Geometry& g = db.geometry();
+        if (db.size()==0 || g!=Geometry::square(g.SR) || g.SR<3 || g.SR>5)
+        {
+            QMessageBox::information(this, tr("Look behind you"),tr("No puzzles this board can show!"));
+            return;
+        }
+
+        int index = 0;
+        if (db.size()>1)
+        {
+            bool ok;
+            int last = db.size() > (unsigned long long)INT_MAX ? INT_MAX : (int)db.size()-1;
+            index = QInputDialog::getInt(this, tr("Pick a puzzle"), tr("Puzzle number:"), 0, 0, last, 1, &ok);
+            if (!ok)
+                return;
+        }
+
+        int N = g.N();
+        int state[N];
+        if (!db.get(index,state))
+        {
+            QMessageBox::information(this, tr("Damaged pack"),tr("Puzzle %1 holds values that don't fit the board.").arg(index));
+            return;
+        }
+        setBoxSize(g.SR);
+        for (int i = 0; i < N; ++i) // without given markings every clue counts as given
+        {
+            if (state[i]<0 || (!db.hasGivens() && state[i]>0))
+                board->setNode(i,state[i]<0 ? -state[i] : state[i],BoardWidget::Given);
+            else
+                board->setNode(i,state[i],BoardWidget::User);
+        }
+    }
+    else 
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) 
+        {
+            QMessageBox::information(this, tr("Unable to open file"),
+                                     file.errorString());
+            return;
+        }
+        QTextStream in(&file);
+       
+        QString state;
+        state = in.readLine();
+
+        // The length of the state tells the size of the board
+        int n = 3;
+        while (n <= 5 && state.length()!=2*n*n*n*n)
+            n++;
+        
+        if (n > 5)
+        {
+            QMessageBox::information(this, tr("Look behind you"),tr("Your file has been corrupted!"));
+            return;
+        }
+
+        setBoxSize(n);
+        
+        for (int i = 0; i < state.length(); i++)
+        {
+            int k = i/2;
+            int kind = state[i].toLatin1()-'0';
+            i++;
+            int v = symbolValue(state[i].toLatin1());
+            if (kind<0 || kind>=BoardWidget::NKinds || v<0 || v>board->size())
+            {
+                QMessageBox::information(this, tr("Look behind you"),tr("Your file has been corrupted!"));
+                board->clear();
+                return;
+            }
+            board->setNode(k,v,(BoardWidget::Kind)kind);
+        }
+    }
+}
+
+void MainWindow::setEasy()
+{
+    level = Grade::Easy;
+    mediumAct->setChecked(0);
+    hardAct->setChecked(0);
+}
+
+void MainWindow::setMedium()
+{
+    level = Grade::Medium;
+    easyAct->setChecked(0);
+    hardAct->setChecked(0);
+}
+
+void MainWindow::setHard()
+{
+    level = Grade::Hard;
+    easyAct->setChecked(0);
+    mediumAct->setChecked(0);
+}
+
+void MainWindow::setBoxSize(int n) // switches to a board of n*n values, clearing it
+{
+    size3Act->setChecked(n==3);
+    size4Act->setChecked(n==4);
+    size5Act->setChecked(n==5);
+    board->setBoxSize(n,n);
+}
+
+void MainWindow::setSize3()
+{
+    setBoxSize(3);
+}
+
+void MainWindow::setSize4()
+{
+    setBoxSize(4);
+}
+
+void MainWindow::setSize5()
+{
+    setBoxSize(5);
+}
+
+void MainWindow::solve()
+{
+    int N = board->nodes();
+    int grid[N];
+
+    // Get input from the grid, givens negative so they are blamed last
+    for (int i = 0; i < N; ++i)
+    {
+        if (board->kind(i)==BoardWidget::Given)
+            grid[i] = -board->value(i);
+        else 
+            grid[i] = board->value(i);
+    }
+
+    // The same solver every time, so an edit that fits the last solution
+    // costs nothing and one that adds entries starts from where it got to
+    Geometry g(board->boxRows(),board->boxCols(),board->boxCols(),board->boxRows());
+    if (!solver || solver->geometry()!=g)
+    {
+        delete solver;
+        solver = new Solver(g);
+        solver->setRandom(true);
+    }
+
+    // One search, and if it fails the entries that clash
+    Limits limits(solveSeconds);
+    Budget budget(limits);
+    solver->setBudget(&budget);
+    int solution[N];
+    std::vector<int> conflict;
+    SearchStatus status = solver->diagnose(grid,solution,conflict);
+    solver->setBudget(0);
+    if ( status==GaveUp )
+    {
+        QMessageBox::information(this, tr("Too hard"),tr("No solution found in time, try adding some numbers."));
+    }
+    else if ( status==Found ) // if solution exists
+    {
+        for (int i = 0; i < N; ++i)
+        { // Enter solution on the grid
+            if (grid[i]==0)
+                board->setNode(i,solution[i],BoardWidget::Solved);
+            else
+                board->setNode(i,solution[i],board->kind(i));
+        }
+    } 
+    else // highlight the entries that can't all be right
+    {
+        for (size_t k = 0; k < conflict.size(); ++k)
+            board->setKind(conflict[k],BoardWidget::Conflict);
+        statusBar()->showMessage(tr("No solution, these %1 entries can't all stay.").arg((int)conflict.size()),5000);
+    }
+}
+
+void MainWindow::hint() // shows the next value that can be worked out, and why
+{
+    int N = board->nodes();
+    Geometry g(board->boxRows(),board->boxCols(),board->boxCols(),board->boxRows());
+    if (!hints || hints->geometry()!=g)
+    {
+        delete hints;
+        hints = new HintEngine(g);
+    }
+
+    // Only nodes that changed since the last hint cost anything
+    for (int i = 0; i < N; ++i)
+        hints->setValue(i,board->value(i));
+
+    // Crossed out candidates don't show on the board, so go on to the
+    // value they lead to and shade the nodes behind every step
+    board->clearMarks();
+    QStringList steps;
+    Hint h;
+    bool found;
+    while ((found = hints->next(h)) && !h.placement() && !h.error())
+    {
+        if (!steps.contains(tr(ruleName(h.rule))))
+            steps.append(tr(ruleName(h.rule)));
+        for (size_t i = 0; i < h.cells.size(); ++i)
+            board->setMarked(h.cells[i],true);
+        hints->apply(h);
+    }
+
+    if (!found)
+    {
+        statusBar()->showMessage(tr("No hint without guessing, try Solve."),5000);
+        return;
+    }
+    for (size_t i = 0; i < h.cells.size(); ++i)
+        board->setMarked(h.cells[i],true);
+
+    if (h.error())
+    {
+        for (size_t i = 0; i < h.cells.size() && h.rule==Hint::Conflict; ++i)
+            board->setKind(h.cells[i],BoardWidget::Conflict);
+        statusBar()->showMessage(h.rule==Hint::Conflict ? tr("These entries clash.")
+                                                         : tr("Something here has nowhere to go."),5000);
+        return;
+    }
+
+    int S = board->size();
+    board->setNode(h.node,h.value,BoardWidget::Solved);
+    hints->apply(h);
+    steps.append(tr(ruleName(h.rule)));
+    statusBar()->showMessage(tr("%1: %2 goes in row %3, column %4.")
+                             .arg(steps.join(", "))
+                             .arg(QChar(symbolChar(h.value)))
+                             .arg(h.node/S+1).arg(h.node%S+1));
+}
+
+void MainWindow::clear() // clears the grid completely
+{
+    board->clear();
+}
+	
+void MainWindow::reset() // reset all entries which are not blue, i.e. not given numbers
+{
+    int N = board->nodes();
+    for (int i = 0; i < N; ++i)
+    {
+        if (board->kind(i)!=BoardWidget::Given)
+        {
+            board->setNode(i,0,BoardWidget::User);
+        }
+    }
+}
+
+void MainWindow::create() // generates random sudoku puzzle with unique solution
+{
+    int n = board->boxRows();
+    int N = board->nodes();
+    int grid[N];
+
+    // The grader rates every removal on the way, so the puzzle comes out
+    // at the level asked for. If time runs out it is the closest one made,
+    // which still has a unique solution.
+    Grader grader(Geometry::square(n));
+    Grade grade;
+    SearchStatus status = grader.generate((Grade::Level)level,grid,grade,Limits(createSeconds));
+
+    // Enter sudoku on the grid
+    for (int i = 0; i < N; ++i)
+    {
+        if (grid[i])
+            board->setNode(i,grid[i],BoardWidget::Given);
+        else
+            board->setNode(i,0,BoardWidget::User);
+    }
+
+    if (status==Found)
+        statusBar()->showMessage(tr("A %1 puzzle.").arg(levelName(grade.level)),5000);
+    else
+        statusBar()->showMessage(tr("No %1 puzzle found in time, this one is %2.")
+                                 .arg(levelName((Grade::Level)level)).arg(levelName(grade.level)),5000);
+}
+
+MainWindow::~MainWindow()
+{
+    delete hints;
+    delete solver;
+}
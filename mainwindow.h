@@ -1,52 +1,60 @@
-#ifndef MAINWINDOW_H
-#define MAINWINDOW_H
-
-#include <QtGui>
-
-class QAction;
-class QLineEdit;
-class QMenu;
-class QPushButton;
-
-class MainWindow : public QMainWindow
-{
-    Q_OBJECT
-
-    enum { SubGridRows = 3 };
-
-    QLineEdit *entries[SubGridRows*SubGridRows][SubGridRows*SubGridRows];
-	
-	QPalette *palettes[4];
-
-    QMenu *fileMenu;
-    QMenu *difficultyMenu;
-    QAction *saveAct;
-    QAction *openAct;
-    QAction *easyAct;
-    QAction *mediumAct;
-    QAction *hardAct;
-
-    int level;
-
-    enum { easy=40, medium=45, hard=50 };
-
-    QColor colors[4];
-
-public:
-    MainWindow(QWidget *parent = 0);
-    ~MainWindow();
-
-private slots:
-    void solve ();
-    void clear ();
-	void reset ();
-	void resetEntryColor ();
-    void create ();
-    void save ();
-    void open ();
-    void setEasy ();
-    void setMedium ();
-    void setHard ();
-};
-
-#endif // MAINWINDOW_H
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QtGui>
+
+class QAction;
+class QMenu;
+class QPushButton;
+class BoardWidget;
+class HintEngine;
+class Solver;
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+    BoardWidget *board;
+    HintEngine *hints; // follows the board one changed node at a time
+    Solver *solver;    // keeps the last solution and candidates for the next Solve
+
+    QMenu *fileMenu;
+    QMenu *difficultyMenu;
+    QMenu *sizeMenu;
+    QAction *saveAct;
+    QAction *openAct;
+    QAction *easyAct;
+    QAction *mediumAct;
+    QAction *hardAct;
+    QAction *size3Act;
+    QAction *size4Act;
+    QAction *size5Act;
+
+    int level; // the Grade::Level Create aims for
+
+    enum { solveSeconds=10, createSeconds=5 }; // keep the window responsive
+
+public:
+    MainWindow(QWidget *parent = 0);
+    ~MainWindow();
+
+private:
+    void setBoxSize (int);
+
+private slots:
+    void solve ();
+    void hint ();
+    void clear ();
+	void reset ();
+    void create ();
+    void save ();
+    void open ();
+    void setEasy ();
+    void setMedium ();
+    void setHard ();
+    void setSize3 ();
+    void setSize4 ();
+    void setSize5 ();
+};
+
+#endif // MAINWINDOW_H
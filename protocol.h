@@ -0,0 +1,89 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "geometry.h"
+#include <string.h>
+
+// Framing between sudokud and its clients over a Unix socket. Every
+// message is a little endian length of the rest of the frame followed
+// by a fixed header and an optional payload, so a client may send many
+// requests before reading any answer and match them up by id.
+//
+// Request                          Response
+//   0  4  length                     0  4  length
+//   4  4  id                         4  4  id
+//   8  1  op                         8  1  op
+//   9  4  SR, SC, NSV, NSH           9  1  status
+//  13  1  flags, zero               10  2  zero
+//  14  2  zero                      12  8  value
+//  16  4  arg                       20     payload
+//  20  4  timeout in ms, 0 default
+//  24     payload
+//
+// Boards travel as one byte per node, 0 for empty.
+//
+//  op        arg                 request payload  value            response payload
+//  Solve     -                   board            nodes searched   solution
+//  Count     stop after, 0 all   board            solutions        -
+//  Generate  entries to remove   -                nodes searched   puzzle
+//  Validate  -                   board            solutions, 0-2   1 per node in conflict
+//  Stats     -                   -                -                text, "name value" lines
+namespace Protocol
+{
+    enum Op { Solve=1, Count, Generate, Validate, Stats };
+    enum Status { Ok=0, NotFound, GaveUp, BadRequest };
+    enum { RequestHeader=24, ResponseHeader=20, MaxFrame=1<<20 };
+
+    inline void put32 (unsigned char *p, unsigned v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = v>>(8*i);
+    }
+
+    inline void put64 (unsigned char *p, unsigned long long v)
+    {
+        for (int i = 0; i < 8; ++i)
+            p[i] = v>>(8*i);
+    }
+
+    inline unsigned get32 (const unsigned char *p)
+    {
+        return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned)p[3]<<24);
+    }
+
+    inline unsigned long long get64 (const unsigned char *p)
+    {
+        return get32(p) | ((unsigned long long)get32(p+4)<<32);
+    }
+
+    // Fills in a request header, the payload of payloadLength bytes follows it
+    inline void request (unsigned char *h, unsigned id, Op op, const Geometry& g,
+                         unsigned arg, unsigned timeoutMs, unsigned payloadLength)
+    {
+        memset(h,0,RequestHeader);
+        put32(h,RequestHeader-4+payloadLength);
+        put32(h+4,id);
+        h[8] = op;
+        h[9] = g.SR; h[10] = g.SC; h[11] = g.NSV; h[12] = g.NSH;
+        put32(h+16,arg);
+        put32(h+20,timeoutMs);
+    }
+
+    inline void response (unsigned char *h, unsigned id, int op, Status status,
+                          unsigned long long value, unsigned payloadLength)
+    {
+        memset(h,0,ResponseHeader);
+        put32(h,ResponseHeader-4+payloadLength);
+        put32(h+4,id);
+        h[8] = op;
+        h[9] = status;
+        put64(h+12,value);
+    }
+
+    inline Geometry geometry (const unsigned char *h)
+    {
+        return Geometry(h[9],h[10],h[11],h[12]);
+    }
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,233 @@
+#include "puzzledb.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace PuzzleDbFormat;
+
+static int bitsFor (int v) // bits needed to store 0..v
+{
+    int b = 0;
+    while ((1<<b) <= v)
+        b++;
+    return b;
+}
+
+static void put16 (unsigned char *p, unsigned v)
+{
+    p[0] = v; p[1] = v>>8;
+}
+
+static void put32 (unsigned char *p, unsigned long v)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = v>>(8*i);
+}
+
+static void put64 (unsigned char *p, unsigned long long v)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = v>>(8*i);
+}
+
+static unsigned long long getLE (const unsigned char *p, int n)
+{
+    unsigned long long v = 0;
+    for (int i = n-1; i >= 0; --i)
+        v = (v<<8)|p[i];
+    return v;
+}
+
+///////////////// ** Writer ** //////////////////
+
+PuzzleDbWriter::PuzzleDbWriter()
+    : file(0), flags(0), bits(0), valueBits(0), recordSize(0), count(0), record(0), failed(false)
+{
+}
+
+PuzzleDbWriter::~PuzzleDbWriter()
+{
+    close();
+}
+
+bool PuzzleDbWriter::writeHeader ()
+{
+    unsigned char h[HeaderSize];
+    memset(h,0,HeaderSize);
+    memcpy(h,"SUDB",4);
+    h[4] = Version;
+    h[5] = geom.SR; h[6] = geom.SC; h[7] = geom.NSV; h[8] = geom.NSH;
+    h[9] = bits;
+    put16(h+10,flags);
+    put32(h+12,recordSize);
+    put64(h+16,count);
+    return fseek(file,0,SEEK_SET)==0 && fwrite(h,1,HeaderSize,file)==HeaderSize;
+}
+
+bool PuzzleDbWriter::open (const char *path, const Geometry& g, int f)
+{
+    close();
+
+    if (g.S()<1 || g.S()>255 || g.N()<1)
+        return false;
+
+    file = fopen(path,"wb");
+    if (!file)
+        return false;
+    setvbuf(file,0,_IOFBF,1<<16);
+
+    geom = g;
+    flags = f;
+    count = 0;
+    failed = false;
+    valueBits = bitsFor(geom.S());
+    bits = valueBits + ((flags & Givens) ? 1 : 0);
+    recordSize = ((size_t)geom.N()*bits+7)/8;
+    record = new unsigned char[recordSize];
+
+    return writeHeader();
+}
+
+bool PuzzleDbWriter::append (const int board[])
+{
+    if (!file)
+        return false;
+
+    memset(record,0,recordSize);
+    int N = geom.N(), S = geom.S();
+    size_t pos = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        int x = board[i];
+        unsigned v = x<0 ? -x : x;
+        if (v > (unsigned)S)
+            return false;
+        if (x<0 && (flags & Givens))
+            v |= 1u<<valueBits;
+        for (int b = 0; b < bits; ++b, ++pos) // nodes may straddle bytes
+            if (v & (1u<<b))
+                record[pos>>3] |= 1<<(pos&7);
+    }
+
+    if (fwrite(record,1,recordSize,file)!=recordSize)
+    {
+        failed = true; // part of a record may be in the file
+        return false;
+    }
+    count++;
+    return true;
+}
+
+bool PuzzleDbWriter::close ()
+{
+    if (!file)
+        return true;
+
+    bool ok = !failed && writeHeader();
+    ok = (fclose(file)==0) && ok;
+    file = 0;
+    delete [] record;
+    record = 0;
+    return ok;
+}
+
+///////////////// ** Reader ** //////////////////
+
+PuzzleDb::PuzzleDb()
+    : data(0), length(0), flags(0), bits(0), recordSize(0), count(0)
+{
+}
+
+PuzzleDb::~PuzzleDb()
+{
+    close();
+}
+
+bool PuzzleDb::open (const char *path)
+{
+    close();
+
+    int fd = ::open(path,O_RDONLY);
+    if (fd<0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd,&st)!=0 || st.st_size < HeaderSize)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *p = mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    ::close(fd); // the mapping keeps the file alive
+    if (p==MAP_FAILED)
+        return false;
+
+    data = (const unsigned char*)p;
+    length = st.st_size;
+
+    const unsigned char *h = data;
+    geom = Geometry(h[5],h[6],h[7],h[8]);
+    bits = h[9];
+    flags = getLE(h+10,2);
+    recordSize = getLE(h+12,4);
+    count = getLE(h+16,8);
+
+    int valueBits = bitsFor(geom.S());
+    bool ok = memcmp(h,"SUDB",4)==0 && h[4]==Version
+        && geom.N()>0
+        && bits == valueBits + ((flags & Givens) ? 1 : 0)
+        && recordSize == ((size_t)geom.N()*bits+7)/8
+        && count <= (length-HeaderSize)/recordSize;
+
+    if (!ok)
+    {
+        close();
+        return false;
+    }
+
+    // Random access is the common case for big collections
+    madvise((void*)data,length,MADV_RANDOM);
+    return true;
+}
+
+void PuzzleDb::close ()
+{
+    if (data)
+        munmap((void*)data,length);
+    data = 0;
+    length = 0;
+    count = 0;
+}
+
+bool PuzzleDb::get (unsigned long long index, int board[]) const
+{
+    const unsigned char *r = record(index);
+    int N = geom.N(), S = geom.S();
+    bool givens = flags & Givens;
+    int valueBits = givens ? bits-1 : bits;
+    unsigned valueMask = (1u<<valueBits)-1;
+
+    // Pull bytes into a small bit buffer and peel nodes off the bottom
+    unsigned long long buf = 0;
+    int have = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        while (have < bits)
+        {
+            buf |= (unsigned long long)*r++ << have;
+            have += 8;
+        }
+        unsigned v = buf & ((1u<<bits)-1);
+        buf >>= bits;
+        have -= bits;
+
+        int x = v & valueMask;
+        if (x > S) // value bits can hold more than S
+            return false;
+        board[i] = (givens && (v>>valueBits)) ? -x : x;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef PUZZLEDB_H
+#define PUZZLEDB_H
+
+#include "geometry.h"
+#include <stdio.h>
+#include <stddef.h>
+
+// Packed binary collections of puzzles (.sdb files).
+//
+// A 32 byte header is followed by fixed size records, one per puzzle,
+// so puzzle i lives at HeaderSize + i*recordSize and can be read without
+// touching the rest of the file. All header fields are little endian.
+//
+//  offset  size
+//   0      4    magic "SUDB"
+//   4      1    format version (1)
+//   5      4    SR, SC, NSV, NSH, one byte each
+//   9      1    bits per node
+//  10      2    flags
+//  12      4    record size in bytes
+//  16      8    number of puzzles
+//  24      8    reserved, zero
+//
+// Each record holds the N nodes in row order, bits per node bits each,
+// starting at the lowest bit of the first byte. A node stores its value
+// (0 is empty) in the low bits and, with the Givens flag, whether it was
+// a given in the bit above. A 9x9 board takes 4 bits per node, 5 with
+// givens, so 41 or 51 bytes per puzzle.
+namespace PuzzleDbFormat
+{
+    enum { HeaderSize = 32, Version = 1 };
+    enum { Givens = 1 }; // flags
+}
+
+// Appends puzzles to a new .sdb file. The count in the header is filled
+// in by close(), so a file that was never closed reads as empty. Once a
+// record fails to write, close() reports the file as failed too.
+class PuzzleDbWriter
+{
+private:
+    FILE *file;
+    Geometry geom;
+    int flags;
+    int bits, valueBits;
+    size_t recordSize;
+    unsigned long long count;
+    unsigned char *record;
+    bool failed;
+
+private:
+    bool writeHeader ();
+
+public:
+    PuzzleDbWriter();
+    ~PuzzleDbWriter();
+
+    bool open (const char*, const Geometry&, int flags=0);
+    bool append (const int[]); // board as taken by the Sudoku constructor
+    bool close ();
+    unsigned long long size () const { return count; }
+};
+
+// Read only view of a .sdb file, memory mapped so opening it costs the
+// same for ten puzzles as for ten million.
+class PuzzleDb
+{
+private:
+    const unsigned char *data;
+    size_t length;
+    Geometry geom;
+    int flags;
+    int bits;
+    size_t recordSize;
+    unsigned long long count;
+
+public:
+    PuzzleDb();
+    ~PuzzleDb();
+
+    bool open (const char*);
+    void close ();
+
+    unsigned long long size () const { return count; }
+    const Geometry& geometry () const { return geom; }
+    bool hasGivens () const { return flags & PuzzleDbFormat::Givens; }
+
+    // Unpacks puzzle i into board, givens negative as for the Sudoku
+    // constructor. board must hold geometry().N() entries. False if the
+    // record holds a value above S, a damaged pack.
+    bool get (unsigned long long, int[]) const;
+    const unsigned char* record (unsigned long long i) const
+    {
+        return data+PuzzleDbFormat::HeaderSize+i*recordSize;
+    }
+};
+
+#endif // PUZZLEDB_H
@@ -0,0 +1,330 @@
+#include "puzzleio.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+///////////////// ** Reader ** //////////////////
+
+PuzzleReader::PuzzleReader(const Geometry& g)
+    : geom(g), N(g.N()), fd(-1), mapped(0), mappedLength(0),
+      buffer(0), capacity(0), pos(0), end(0), eof(true), lines(0), skipped(0)
+{
+    // One lookup per byte tells what it is
+    for (int i = 0; i < 256; ++i)
+    {
+        int v = symbolValue(i);
+        if (i=='.' || i=='0')
+            table[i] = Blank;
+        else if (v>0 && v<=geom.S())
+            table[i] = v;
+        else
+            table[i] = Other;
+    }
+    const char *spaces = " \t\r\f\v", *separators = "|-+=:,*!";
+    for (const char *s = spaces; *s; ++s)
+        table[(unsigned char)*s] = Space;
+    for (const char *s = separators; *s; ++s)
+        table[(unsigned char)*s] = Separator;
+    table[(unsigned char)'#'] = Comment;
+    table[(unsigned char)'\n'] = Newline;
+}
+
+PuzzleReader::~PuzzleReader()
+{
+    close();
+}
+
+bool PuzzleReader::open (const char *path)
+{
+    close();
+
+    if (strcmp(path,"-")==0)
+    {
+        fd = 0;
+    }
+    else
+    {
+        fd = ::open(path,O_RDONLY);
+        if (fd<0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd,&st)==0 && S_ISREG(st.st_mode) && st.st_size>0)
+        {
+            void *p = mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            if (p!=MAP_FAILED)
+            {
+                ::close(fd);
+                fd = -1;
+                madvise(p,st.st_size,MADV_SEQUENTIAL);
+                mapped = (const char*)p;
+                mappedLength = st.st_size;
+                pos = mapped;
+                end = mapped+mappedLength;
+                eof = true;
+                return true;
+            }
+        }
+    }
+
+    capacity = 1<<20;
+    buffer = (char*)malloc(capacity);
+    pos = end = buffer;
+    eof = false;
+    return true;
+}
+
+void PuzzleReader::openMemory (const char *data, size_t length)
+{
+    close();
+    mapped = data; // not owned, so mappedLength stays 0
+    pos = data;
+    end = data+length;
+    eof = true;
+}
+
+void PuzzleReader::close ()
+{
+    if (mappedLength)
+        munmap((void*)mapped,mappedLength);
+    if (fd>0)
+        ::close(fd);
+    free(buffer);
+    fd = -1;
+    mapped = 0;
+    mappedLength = 0;
+    buffer = 0;
+    capacity = 0;
+    pos = end = 0;
+    eof = true;
+    lines = skipped = 0;
+}
+
+bool PuzzleReader::fill () // moves the unfinished line to the front and reads more
+{
+    size_t left = end-pos;
+    if (left==capacity) // a line longer than the buffer
+    {
+        capacity *= 2;
+        char *grown = (char*)realloc(buffer,capacity);
+        if (!grown)
+            return false;
+        buffer = grown;
+    }
+    else
+    {
+        memmove(buffer,pos,left);
+    }
+    pos = buffer;
+    end = buffer+left;
+
+    while (1)
+    {
+        ssize_t n = read(fd,buffer+left,capacity-left);
+        if (n<0 && errno==EINTR)
+            continue;
+        if (n<=0)
+            return false;
+        end += n;
+        return true;
+    }
+}
+
+bool PuzzleReader::nextLine (const char*& b, const char*& e)
+{
+    while (1)
+    {
+        const char *nl = (const char*)memchr(pos,'\n',end-pos);
+        if (nl)
+        {
+            b = pos;
+            e = nl;
+            pos = nl+1;
+            lines++;
+            return true;
+        }
+
+        if (eof || !fill())
+        {
+            eof = true;
+            if (pos==end)
+                return false;
+            b = pos; // last line without a newline
+            e = end;
+            pos = end;
+            lines++;
+            return true;
+        }
+    }
+}
+
+bool PuzzleReader::title (const char *b, const char *e) const // first word has a letter no node holds
+{
+    while (b < e && table[(unsigned char)*b]==Space)
+        ++b;
+    for (; b < e && table[(unsigned char)*b]!=Space; ++b)
+    {
+        char ch = *b;
+        if (((ch>='A' && ch<='Z') || (ch>='a' && ch<='z')) && table[(unsigned char)ch]==Other)
+            return true;
+    }
+    return false;
+}
+
+bool PuzzleReader::next (int board[])
+{
+    int count = 0;
+    const char *b, *e;
+
+    while (nextLine(b,e))
+    {
+        if (title(b,e)) // names the grid that follows, so one in progress is cut short
+        {
+            if (count>0)
+                skipped++;
+            count = 0;
+            continue;
+        }
+
+        int start = count;
+        bool bad = false, comment = false, rule = false;
+
+        for (const char *p = b; p < e && count < N; ++p)
+        {
+            int t = table[(unsigned char)*p];
+            if (t < Blank)
+                board[count++] = t;
+            else if (t==Blank)
+                board[count++] = 0;
+            else if (t==Space)
+                continue;
+            else if (t==Separator)
+                rule = true;
+            else if (t==Comment)
+            {
+                comment = true;
+                break;
+            }
+            else
+            {
+                bad = true;
+                break;
+            }
+        }
+
+        if (bad) // not a puzzle line, forget it but keep a grid in progress
+        {
+            count = start;
+            skipped++;
+        }
+        else if (count==N)
+        {
+            return true;
+        }
+        else if (count==start && count>0 && !comment && !rule) // blank line cuts a grid short, band rules don't
+        {
+            count = 0;
+            skipped++;
+        }
+    }
+
+    if (count>0)
+        skipped++;
+    return false;
+}
+
+///////////////// ** Writer ** //////////////////
+
+PuzzleWriter::PuzzleWriter(int f)
+    : fd(f), ownFd(false), capacity(1<<16), used(0), failed(false)
+{
+    buffer = (char*)malloc(capacity);
+}
+
+PuzzleWriter::~PuzzleWriter()
+{
+    close();
+    free(buffer);
+}
+
+bool PuzzleWriter::open (const char *path)
+{
+    close();
+    failed = false;
+    if (strcmp(path,"-")==0)
+    {
+        fd = 1;
+        return true;
+    }
+    fd = ::open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    ownFd = true;
+    return fd>=0;
+}
+
+void PuzzleWriter::write (const int board[], int N)
+{
+    if (capacity-used < (size_t)N+1)
+    {
+        flush();
+        if (capacity < (size_t)N+1)
+        {
+            capacity = N+1;
+            buffer = (char*)realloc(buffer,capacity);
+        }
+    }
+
+    char *p = buffer+used;
+    for (int i = 0; i < N; ++i)
+    {
+        int v = board[i]<0 ? -board[i] : board[i];
+        *p++ = v ? symbolChar(v) : '.';
+    }
+    *p++ = '\n';
+    used = p-buffer;
+}
+
+void PuzzleWriter::write (const char *text, size_t length)
+{
+    if (capacity-used < length)
+    {
+        flush();
+        if (capacity < length)
+        {
+            capacity = length;
+            buffer = (char*)realloc(buffer,capacity);
+        }
+    }
+    memcpy(buffer+used,text,length);
+    used += length;
+}
+
+bool PuzzleWriter::flush ()
+{
+    size_t done = 0;
+    while (done < used && !failed)
+    {
+        ssize_t n = ::write(fd,buffer+done,used-done);
+        if (n<0 && errno==EINTR)
+            continue;
+        if (n<=0)
+            failed = true;
+        else
+            done += n;
+    }
+    used = 0;
+    return !failed;
+}
+
+bool PuzzleWriter::close ()
+{
+    bool ok = fd<0 || flush();
+    if (ownFd && fd>=0)
+        ok = (::close(fd)==0) && ok;
+    fd = -1;
+    ownFd = false;
+    return ok;
+}
@@ -0,0 +1,84 @@
+#ifndef PUZZLEIO_H
+#define PUZZLEIO_H
+
+#include "geometry.h"
+#include <stddef.h>
+
+// Streaming reader for puzzles in text. Both one puzzle per line
+// (81 symbols for 9x9) and multi-line grid dumps are understood:
+// symbols are collected across lines until a board is full, and
+// separators such as spaces, | - + = are skipped. Empty nodes are
+// . or 0. Everything after a # is a comment. A line whose first word
+// has a letter that isn't a symbol of the size read is a title, like
+// "Grid 01" or "Puzzle 3", and is passed over before any of it is read
+// as symbols; like a blank line it cuts a grid in progress short. Other
+// lines with any other character are skipped as a whole, as is the
+// rest of the line once a board is full.
+//
+// Regular files are memory mapped, anything else is read in large
+// blocks. Symbols are decoded straight from the buffer into the board,
+// no strings are built on the way.
+class PuzzleReader
+{
+private:
+    enum { Blank = 64, Space, Separator, Comment, Newline, Other }; // symbol classes above any value
+
+    Geometry geom;
+    int N;
+    signed char table[256];
+
+    int fd;
+    const char *mapped;   // whole file when memory mapped
+    size_t mappedLength;
+    char *buffer;         // otherwise read into this
+    size_t capacity;
+    const char *pos, *end;
+    bool eof;
+
+    unsigned long long lines;
+    unsigned long long skipped;
+
+private:
+    bool fill ();
+    bool nextLine (const char*&, const char*&);
+    bool title (const char*, const char*) const;
+
+public:
+    PuzzleReader(const Geometry& g = Geometry());
+    ~PuzzleReader();
+
+    bool open (const char*); // "-" is standard input
+    void openMemory (const char*, size_t);
+    void close ();
+
+    // Reads the next puzzle into board (N entries, 0 for empty),
+    // returns false at the end of the input.
+    bool next (int[]);
+
+    unsigned long long lineNumber () const { return lines; }
+    unsigned long long skippedLines () const { return skipped; } // unreadable or incomplete
+};
+
+// Buffered writer for boards, one line of symbols per board with . for
+// empty nodes. Nothing is allocated per board.
+class PuzzleWriter
+{
+private:
+    int fd;
+    bool ownFd;
+    char *buffer;
+    size_t capacity, used;
+    bool failed;
+
+public:
+    PuzzleWriter(int fd = 1);
+    ~PuzzleWriter();
+
+    bool open (const char*); // "-" is standard output
+    void write (const int[], int); // board and its number of nodes, signs ignored
+    void write (const char*, size_t); // raw text
+    bool flush ();
+    bool close ();
+};
+
+#endif // PUZZLEIO_H
@@ -0,0 +1,709 @@
+#include "solver.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+static inline int popcount (Solver::Mask m)
+{
+    return __builtin_popcount(m);
+}
+
+static inline bool single (Solver::Mask m)
+{
+    return m && !(m & (m-1));
+}
+
+///////////////// ** Limits ** //////////////////
+
+Budget::Budget(const Limits& l)
+    : limits(l), start(Clock::now()), used(0), out(false)
+{
+    deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(l.seconds));
+}
+
+bool Budget::check ()
+{
+    if (!out)
+    {
+        if ((limits.token && limits.token->cancelled()) || (limits.seconds>0 && Clock::now()>=deadline))
+            out = true;
+    }
+    return !out;
+}
+
+SearchStats Budget::stats () const
+{
+    SearchStats s;
+    s.nodes = used;
+    s.seconds = std::chrono::duration<double>(Clock::now()-start).count();
+    s.gaveUp = out;
+    return s;
+}
+
+///////////////// ** Solver ** //////////////////
+
+Solver::Solver(const Geometry& g)
+    : Solver(ConstraintGraph(g))
+{
+}
+
+Solver::Solver(const ConstraintGraph& g)
+    : graph(g), N(g.geometry().N()), S(g.geometry().S()), state(Done), random(false), nodes(0),
+      budget(0), halted(false), warm(false), explaining(false), W(0)
+{
+    full = S>=32 ? ~0u : (1u<<S)-1;
+    cand.assign(N,full);
+    warmBoard.assign(N,0);
+    warmSolution.assign(N,0);
+    warmCand.assign(N,full);
+    trail.reserve(N*S+N);
+    queue.reserve(N);
+    stack.reserve(N);
+}
+
+bool Solver::load (const int board[])
+{
+    trail.clear();
+    queue.clear();
+    stack.clear();
+    nodes = 0;
+    halted = false;
+    state = Fresh;
+
+    for (int i = 0; i < N; ++i)
+    {
+        int x = board[i]<0 ? -board[i] : board[i];
+        if (x>S)
+        {
+            state = Done;
+            return false;
+        }
+        cand[i] = x ? 1u<<(x-1) : full;
+        if (x)
+            queue.push_back(i);
+    }
+
+    if (explaining) // an entry is the reason for its node's other values going
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            if (cand[i]==full)
+                continue;
+            std::fill(cause.begin(),cause.end(),0);
+            cause[i/64] |= 1ull<<(i%64);
+            for (int v = 0; v < S; ++v)
+            {
+                if (!(cand[i]>>v & 1))
+                    std::copy(cause.begin(),cause.end(),why.begin()+(i*S+v)*W);
+            }
+        }
+    }
+    return true;
+}
+
+void Solver::values (int out[]) const
+{
+    for (int i = 0; i < N; ++i)
+        out[i] = single(cand[i]) ? __builtin_ctz(cand[i])+1 : 0;
+}
+
+///////////////// ** Propagation ** //////////////////
+
+// With a reason, it is noted for every value taken out
+static inline void note (std::vector<Solver::Word>& why, int W, int S, int n, Solver::Mask gone, const Solver::Word *reason)
+{
+    for (; gone; gone &= gone-1)
+        std::copy(reason,reason+W,why.begin()+(n*S+__builtin_ctz(gone))*W);
+}
+
+bool Solver::eliminate (int n, Mask bits, const Word *reason)
+{
+    Mask m = cand[n];
+    if (!(m & bits))
+        return true;
+
+    Change c = { n, m };
+    trail.push_back(c);
+    if (reason)
+        note(why,W,S,n,m & bits,reason);
+    m &= ~bits;
+    cand[n] = m;
+
+    if (!m)
+        return false;
+    if (single(m))
+        queue.push_back(n);
+    return true;
+}
+
+bool Solver::assign (int n, Mask bit, const Word *reason)
+{
+    Mask m = cand[n];
+    if (!(m & bit))
+        return false;
+    if (m==bit)
+        return true;
+
+    Change c = { n, m };
+    trail.push_back(c);
+    if (reason)
+        note(why,W,S,n,m & ~bit,reason);
+    cand[n] = bit;
+    queue.push_back(n);
+    return true;
+}
+
+bool Solver::propagate ()
+{
+    int G = graph.units();
+
+    while (1)
+    {
+        // Take fixed values out of every peer
+        while (!queue.empty())
+        {
+            int n = queue.back();
+            queue.pop_back();
+            Mask bit = cand[n];
+            const Word *reason = 0;
+            if (explaining) // n holds its value because every other one went
+            {
+                std::fill(cause.begin(),cause.end(),0);
+                blame(&cause[0],n,full & ~bit);
+                reason = &cause[0];
+            }
+            for (const int *p = graph.peersBegin(n); p != graph.peersEnd(n); ++p)
+            {
+                if (!eliminate(*p,bit,reason))
+                {
+                    if (explaining)
+                    {
+                        std::fill(clash.begin(),clash.end(),0);
+                        blame(&clash[0],*p,full);
+                    }
+                    queue.clear();
+                    return false;
+                }
+            }
+        }
+
+        // Values that fit only one node of a full unit go there
+        for (int g = 0; g < G; ++g)
+        {
+            const int *b = graph.unitBegin(g), *e = graph.unitEnd(g);
+            if (e-b != S)
+                continue;
+
+            Mask once = 0, twice = 0, fixed = 0;
+            for (const int *i = b; i < e; ++i)
+            {
+                Mask m = cand[*i];
+                twice |= once & m;
+                once |= m;
+                if (single(m))
+                    fixed |= m;
+            }
+            if (once != full) // some value fits nowhere
+            {
+                if (explaining)
+                {
+                    Mask v = full & ~once;
+                    std::fill(clash.begin(),clash.end(),0);
+                    for (const int *i = b; i < e; ++i)
+                        blame(&clash[0],*i,v & -v);
+                }
+                queue.clear();
+                return false;
+            }
+
+            Mask hidden = once & ~twice & ~fixed;
+            for (const int *i = b; i < e && hidden; ++i)
+            {
+                int n = *i;
+                Mask m = cand[n] & hidden;
+                if (!m)
+                    continue;
+                if (!single(m)) // two values both need this node
+                {
+                    if (explaining)
+                    {
+                        std::fill(clash.begin(),clash.end(),0);
+                        for (const int *j = b; j < e; ++j)
+                            if (*j!=n)
+                                blame(&clash[0],*j,m);
+                    }
+                    queue.clear();
+                    return false;
+                }
+                const Word *reason = 0;
+                if (explaining) // the value went from every other node of the unit
+                {
+                    std::fill(cause.begin(),cause.end(),0);
+                    for (const int *j = b; j < e; ++j)
+                        if (*j!=n)
+                            blame(&cause[0],*j,m);
+                    reason = &cause[0];
+                }
+                assign(n,m,reason);
+                hidden &= ~m;
+            }
+        }
+
+        if (queue.empty())
+            return true;
+    }
+}
+
+void Solver::undo (int size)
+{
+    while ((int)trail.size() > size)
+    {
+        const Change& c = trail.back();
+        cand[c.node] = c.old;
+        trail.pop_back();
+    }
+}
+
+///////////////// ** Search ** //////////////////
+
+int Solver::pick () const // node with the fewest candidates, -1 if all are fixed
+{
+    int min = MaxValues+1, k = -1;
+    for (int i = 0; i < N; ++i)
+    {
+        int m = popcount(cand[i]);
+        if (m==1)
+            continue;
+        if (m < min || (random && m==min && rand()%5==0))
+        {   // pick random node with minimal possibilities
+            k = i;
+            min = m;
+            if (m==2 && !random)
+                break;
+        }
+    }
+    return k;
+}
+
+bool Solver::advance () // takes the next untried choice, false when there are none left
+{
+    while (!stack.empty())
+    {
+        if (budget && !budget->spend()) // stop with the stack as it is, to carry on later
+        {
+            halted = true;
+            return false;
+        }
+
+        Frame& f = stack.back();
+        undo(f.trail);
+        if (!f.left)
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        Mask bit = f.left & -f.left;
+        if (random)
+        {
+            int k = rand()%popcount(f.left);
+            Mask m = f.left;
+            while (k--)
+                m &= m-1;
+            bit = m & -m;
+        }
+        f.left &= ~bit;
+        f.chosen = bit;
+        nodes++;
+
+        if (assign(f.node,bit) && propagate())
+            return true;
+    }
+    return false;
+}
+
+bool Solver::settle ()
+{
+    if (state!=Fresh)
+        return state==Searching;
+    state = Searching;
+    if (!propagate())
+    {
+        state = Done;
+        return false;
+    }
+    return true;
+}
+
+bool Solver::next (int solution[])
+{
+    if (state==Done)
+        return false;
+
+    halted = false;
+    if (state==Fresh)
+    {
+        if (!settle())
+            return false;
+    }
+    else if (!advance()) // move past the previous solution, or carry on after a stop
+    {
+        if (!halted)
+            state = Done;
+        return false;
+    }
+
+    while (1)
+    {
+        int n = pick();
+        if (n<0)
+        {
+            if (solution)
+                values(solution);
+            return true;
+        }
+
+        Frame f = { n, cand[n], 0, (int)trail.size() };
+        stack.push_back(f);
+        if (!advance())
+        {
+            if (!halted)
+                state = Done;
+            return false;
+        }
+    }
+}
+
+void Solver::frontier (std::vector<Decision>& path) const
+{
+    path.clear();
+    if (state!=Searching)
+        return;
+    for (size_t i = 0; i < stack.size(); ++i)
+    {
+        const Frame& f = stack[i];
+        Decision d = { f.node, f.chosen ? __builtin_ctz(f.chosen)+1 : 0, f.left };
+        path.push_back(d);
+    }
+}
+
+bool Solver::resume (const int board[], const std::vector<Decision>& path)
+{
+    if (!load(board))
+        return false;
+    if (path.empty())
+        return true;
+    if (!settle())
+        return false;
+
+    // Rebuild every choice but the last, whose subtree is done with
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        const Decision& d = path[i];
+        if (d.node<0 || d.node>=N || (d.left & ~full))
+            break;
+        Frame f = { d.node, d.left, 0, (int)trail.size() };
+        stack.push_back(f);
+        if (i+1==path.size())
+            return true;
+
+        Mask bit = d.value>0 && d.value<=S ? 1u<<(d.value-1) : 0;
+        stack.back().chosen = bit;
+        if (!bit || !assign(d.node,bit) || !propagate())
+            break;
+    }
+    state = Done; // not a path this board can take
+    stack.clear();
+    return false;
+}
+
+bool Solver::solve (int solution[])
+{
+    return next(solution);
+}
+
+unsigned long long Solver::count (unsigned long long limit)
+{
+    unsigned long long n = 0;
+    while ((!limit || n<limit) && next(0))
+        n++;
+    return n;
+}
+
+unsigned long long Solver::enumerate (Visitor visit, void *context)
+{
+    std::vector<int> solution(N);
+    unsigned long long n = 0;
+    while (next(&solution[0]))
+    {
+        n++;
+        if (!visit(&solution[0],context))
+            break;
+    }
+    return n;
+}
+
+///////////////// ** Warm starts ** //////////////////
+
+bool Solver::loadWarm (const int board[]) // the last board's candidates plus the new entries
+{
+    trail.clear();
+    queue.clear();
+    stack.clear();
+    nodes = 0;
+    halted = false;
+    state = Fresh;
+    for (int i = 0; i < N; ++i)
+        cand[i] = warmCand[i];
+
+    for (int i = 0; i < N; ++i)
+    {
+        int x = board[i]<0 ? -board[i] : board[i];
+        if (x && !warmBoard[i] && !assign(i,1u<<(x-1)))
+        {
+            state = Done; // ruled out by the last board already
+            return false;
+        }
+    }
+    return true;
+}
+
+SearchStatus Solver::resolve (const int board[], int solution[])
+{
+    bool agrees = warm, grows = warm;
+    for (int i = 0; i < N; ++i)
+    {
+        int x = board[i]<0 ? -board[i] : board[i];
+        if (x>S)
+        {
+            state = Done;
+            return NotFound;
+        }
+        if (x && x!=warmSolution[i])
+            agrees = false;
+        if (warmBoard[i] && x!=warmBoard[i])
+            grows = false;
+    }
+
+    if (agrees) // the last solution still fits
+    {
+        for (int i = 0; i < N; ++i)
+            solution[i] = warmSolution[i];
+        halted = false;
+        return Found;
+    }
+
+    if (grows)
+        loadWarm(board);
+    else
+        load(board);
+    if (!next(solution))
+        return halted ? GaveUp : NotFound;
+
+    // Keep the candidates from before the first choice for the next edit
+    undo(stack.empty() ? trail.size() : stack[0].trail);
+    for (int i = 0; i < N; ++i)
+    {
+        int x = board[i]<0 ? -board[i] : board[i];
+        warmBoard[i] = x;
+        warmSolution[i] = solution[i];
+        warmCand[i] = cand[i];
+    }
+    warm = true;
+    stack.clear();
+    state = Done;
+    return Found;
+}
+
+///////////////// ** Diagnosis ** //////////////////
+
+void Solver::blame (Word out[], int n, Mask gone) const // adds why the values gone went from n
+{
+    for (; gone; gone &= gone-1)
+    {
+        const Word *w = &why[(n*S+__builtin_ctz(gone))*W];
+        for (int k = 0; k < W; ++k)
+            out[k] |= w[k];
+    }
+}
+
+// Search below a propagated board, NotFound with clash holding what the
+// failure came down to. A choice the failure under it doesn't depend on
+// is given up at once, as no other value can help.
+SearchStatus Solver::refute (int depth)
+{
+    int n = pick();
+    if (n<0)
+        return Found;
+
+    Mask left = cand[n];
+    int mark = trail.size();
+    int choice = N+n;
+    Word *acc = &learned[depth*W];
+    std::fill(acc,acc+W,0);
+
+    for (Mask m = left; m; m &= m-1)
+    {
+        if (budget && !budget->spend())
+        {
+            halted = true;
+            return GaveUp;
+        }
+        nodes++;
+        undo(mark);
+
+        std::fill(cause.begin(),cause.end(),0);
+        cause[choice/64] |= 1ull<<(choice%64);
+        assign(n,m & -m,&cause[0]);
+        SearchStatus status = propagate() ? refute(depth+1) : NotFound;
+        if (status!=NotFound)
+            return status;
+        if (!(clash[choice/64]>>(choice%64) & 1))
+        {
+            undo(mark);
+            return NotFound;
+        }
+        clash[choice/64] &= ~(1ull<<(choice%64));
+        for (int k = 0; k < W; ++k)
+            acc[k] |= clash[k];
+    }
+
+    // Every value failed, and the ones gone before had their own reasons
+    undo(mark);
+    blame(acc,n,full & ~left);
+    std::copy(acc,acc+W,clash.begin());
+    return NotFound;
+}
+
+SearchStatus Solver::diagnose (const int board[], int solution[], std::vector<int>& conflict)
+{
+    conflict.clear();
+    SearchStatus status = resolve(board,solution);
+    if (status!=NotFound)
+        return status;
+
+    // Search again noting reasons, the failure at the top is down to entries only
+    W = (2*N+63)/64;
+    why.assign(N*S*W,0);
+    clash.assign(W,0);
+    cause.assign(W,0);
+    learned.assign((N+1)*W,0);
+    explaining = true;
+    halted = false;
+    if (!load(board))
+    {
+        explaining = false;
+        return NotFound;
+    }
+    nodes = 0;
+    state = Searching;
+    status = propagate() ? refute(0) : NotFound;
+    explaining = false;
+    stack.clear();
+    state = Done;
+
+    if (status==Found)
+        values(solution);
+    if (status!=NotFound)
+        return status;
+    for (int i = 0; i < N; ++i)
+    {
+        if (clash[i/64]>>(i%64) & 1)
+            conflict.push_back(i);
+    }
+    return NotFound;
+}
+
+///////////////// ** Parallel counting ** //////////////////
+
+unsigned long long parallelCount (const Geometry& g, const int board[], int threads,
+                                  const Limits& limits, SearchStats *stats)
+{
+    return parallelCount(ConstraintGraph(g),board,threads,limits,stats);
+}
+
+unsigned long long parallelCount (const ConstraintGraph& g, const int board[], int threads,
+                                  const Limits& limits, SearchStats *stats)
+{
+    if (threads<=0)
+        threads = std::thread::hardware_concurrency();
+    if (threads<=0)
+        threads = 1;
+
+    int N = g.geometry().N();
+    Budget budget(limits);
+    Solver solver(g);
+    solver.setBudget(&budget);
+
+    // Expand the root breadth first until there is plenty of work per thread
+    std::vector< std::vector<int> > work(1,std::vector<int>(board,board+N));
+    unsigned long long total = 0;
+    size_t head = 0, wanted = threads>1 ? threads*64 : 1;
+
+    while (head < work.size() && work.size()-head < wanted && budget.spend())
+    {
+        std::vector<int> b;
+        b.swap(work[head++]);
+        if (!solver.load(&b[0]) || !solver.settle())
+            continue;
+
+        int n = solver.branchNode();
+        if (n<0)
+        {
+            total++;
+            continue;
+        }
+
+        solver.values(&b[0]);
+        Solver::Mask m = solver.candidates(n);
+        for (int v = 1; m; ++v, m >>= 1)
+        {
+            if (m & 1)
+            {
+                b[n] = v;
+                work.push_back(b);
+            }
+        }
+    }
+
+    // Each thread gets the time that is left and its share of the nodes
+    SearchStats root = budget.stats();
+    Limits share(limits.seconds>0 ? std::max(limits.seconds-root.seconds,1e-9) : 0, 0, limits.token);
+    if (limits.maxNodes)
+        share.maxNodes = limits.maxNodes>root.nodes ? (limits.maxNodes-root.nodes)/threads+1 : 1;
+
+    std::atomic<size_t> nextItem(head);
+    std::atomic<unsigned long long> sum(total), nodes(root.nodes);
+    std::atomic<bool> gaveUp(budget.exhausted());
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads && !gaveUp; ++t)
+    {
+        pool.push_back(std::thread([&]() {
+            Budget mine(share);
+            Solver s(g);
+            s.setBudget(&mine);
+            unsigned long long found = 0;
+            size_t i;
+            while (!gaveUp && (i = nextItem++) < work.size())
+            {
+                s.load(&work[i][0]);
+                found += s.count();
+                if (s.stopped())
+                    gaveUp = true;
+            }
+            sum += found;
+            nodes += mine.stats().nodes;
+        }));
+    }
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+
+    if (stats)
+    {
+        stats->nodes = nodes;
+        stats->seconds = budget.stats().seconds;
+        stats->gaveUp = gaveUp;
+    }
+    return sum;
+}
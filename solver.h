@@ -0,0 +1,229 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "geometry.h"
+#include "graph.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Lets another thread stop a search. Searches poll it now and then,
+// so stopping takes effect within a fraction of a millisecond.
+class CancelToken
+{
+private:
+    std::atomic<bool> flag;
+
+public:
+    CancelToken() : flag(false) {}
+    void cancel () { flag = true; }
+    void reset () { flag = false; }
+    bool cancelled () const { return flag.load(std::memory_order_relaxed); }
+};
+
+// How much a search may take: time in seconds, choices (search nodes)
+// and a token to cancel it. Zero means no limit.
+struct Limits
+{
+    double seconds;
+    unsigned long long maxNodes;
+    const CancelToken *token;
+
+    Limits(double s=0, unsigned long long n=0, const CancelToken *t=0)
+        : seconds(s), maxNodes(n), token(t) {}
+};
+
+// How a search ended, and what it took
+enum SearchStatus { Found, NotFound, GaveUp };
+
+struct SearchStats
+{
+    unsigned long long nodes;
+    double seconds;
+    bool gaveUp;
+};
+
+// Limits of one request, started when built and charged one node at a
+// time by every search made for that request.
+class Budget
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Limits limits;
+    Clock::time_point start, deadline;
+    unsigned long long used;
+    bool out;
+
+public:
+    Budget(const Limits& l = Limits());
+
+    bool spend ()  // charges a node, false once the budget is gone
+    {
+        if (out)
+            return false;
+        used++;
+        if ((limits.maxNodes && used > limits.maxNodes) || ((used & 255)==0 && !check()))
+            out = true;
+        return !out;
+    }
+    bool check (); // looks at the clock and the token, false once the budget is gone
+    bool exhausted () const { return out; }
+    SearchStats stats () const;
+};
+
+// Search engine behind Sudoku. Candidates of a node are bits of a mask
+// (bit v-1 for value v), propagation removes fixed values from peers and
+// places values that fit only one node of a group, and the search is
+// an explicit stack of choices undone from a trail of changed masks.
+// Nothing is allocated once the solver is built, and the stack and
+// trail never grow past N and N*S entries, so enumerating millions of
+// solutions runs in the same memory as finding one.
+class Solver
+{
+public:
+    typedef unsigned int Mask;
+    typedef unsigned long long Word; // of a set of entries and choices, when explaining
+    enum { MaxValues = 32 };
+
+    // Called for each solution by enumerate(), return false to stop
+    typedef bool (*Visitor)(const int[], void*);
+
+    // One choice on the way to where the search is: the value taken at
+    // node, and the values still to try there. The last one's value is
+    // already done with, only what is left of it remains.
+    struct Decision
+    {
+        int node;
+        int value;
+        Mask left;
+    };
+
+private:
+    struct Change
+    {
+        int node;
+        Mask old;
+    };
+
+    struct Frame
+    {
+        int node;
+        Mask left;   // values still to try
+        Mask chosen; // value being tried
+        int trail;   // trail size before the choice
+    };
+
+    ConstraintGraph graph; // units and peers
+    int N, S;
+    Mask full;
+
+    std::vector<Mask> cand;
+    std::vector<Change> trail;
+    std::vector<int> queue;  // nodes fixed but not yet taken from their peers
+    std::vector<Frame> stack;
+
+    enum { Fresh, Searching, Done } state;
+    bool random;
+    unsigned long long nodes;
+    Budget *budget;
+    bool halted;
+
+    // Last board given to resolve() with its candidates after propagation,
+    // and the solution found for it
+    std::vector<int> warmBoard, warmSolution;
+    std::vector<Mask> warmCand;
+    bool warm;
+
+    // While explaining, why each value was taken out of each node, as a
+    // set of W words with bit n for the entry at n and bit N+n for the
+    // choice made at n, and what the last failure came down to
+    bool explaining;
+    int W;
+    std::vector<Word> why, clash, cause, learned;
+
+private:
+    bool eliminate (int,Mask,const Word* =0);
+    bool assign (int,Mask,const Word* =0);
+    bool propagate ();
+    void undo (int);
+    bool advance ();
+    int pick () const;
+    bool loadWarm (const int[]);
+    void blame (Word[], int, Mask) const;
+    SearchStatus refute (int);
+
+public:
+    Solver(const Geometry&);        // classic rows, columns and subgrids
+    Solver(const ConstraintGraph&); // jigsaw, diagonal and other variants
+
+    void setRandom (bool r) { random = r; } // random choices, for generating
+
+    // Charges every choice to budget (may be null). When it runs out,
+    // next() returns false with stopped() set, and calling next() again
+    // with budget to spare carries on where the search left off.
+    void setBudget (Budget *b) { budget = b; }
+    bool stopped () const { return halted; }
+    const Geometry& geometry () const { return graph.geometry(); }
+    const ConstraintGraph& constraints () const { return graph; }
+
+    // Starts a new search from a board as taken by the Sudoku constructor
+    // (0 empty, signs ignored). Returns false on a value out of range.
+    bool load (const int[]);
+
+    // Writes the next solution, or returns false when there are no more.
+    // solution may be null when only counting.
+    bool next (int[]);
+
+    bool solve (int[]); // first solution of the loaded board
+    unsigned long long count (unsigned long long limit=0); // 0 is no limit
+    unsigned long long enumerate (Visitor, void*);
+
+    // Root of the search, for splitting work: settle() propagates the
+    // loaded board (false if that fails), branchNode() is the node the
+    // search would branch on (-1 when solved), values() the fixed nodes.
+    bool settle ();
+    int branchNode () const { return pick(); }
+    Mask candidates (int n) const { return cand[n]; }
+    void values (int[]) const;
+
+    // Where a stopped search is, as the choices on its stack. Loading the
+    // same board and resuming those choices carries on from there, in
+    // this or another solver, so a search can be saved or handed over.
+    // An empty list is a search not started, or finished if done().
+    void frontier (std::vector<Decision>&) const;
+    bool resume (const int[], const std::vector<Decision>&);
+    bool done () const { return state==Done; }
+
+    // solve() for a board that changes a little between calls, as in an
+    // editor. A board whose entries all agree with the last solution found
+    // gets that solution back at once. One that only adds entries to the
+    // last board searched starts from that board's propagated candidates,
+    // so only the new entries and their peers are propagated before the
+    // search. Anything else is loaded afresh. Found, NotFound or GaveUp.
+    SearchStatus resolve (const int board[], int solution[]);
+
+    // Solves board with resolve(), or when it has none finds entries to
+    // blame: a set with no solution of its own, usually far smaller than
+    // the board but not always minimal. It comes from one more search
+    // that notes why every candidate goes, so each failure is traced back
+    // to the entries behind it and choices that played no part in one
+    // are jumped over. Found with solution written, NotFound with the set
+    // in conflict, GaveUp if the budget ran out before either was known.
+    SearchStatus diagnose (const int board[], int solution[], std::vector<int>& conflict);
+
+    unsigned long long nodesVisited () const { return nodes; }
+};
+
+// Number of solutions of a board, split over threads. The root is
+// expanded breadth first into many smaller boards that the threads take
+// one at a time, so grids with millions of completions keep every core
+// busy. threads <= 0 uses every core. With limits, the deadline and the
+// token hold for every thread and the node budget is split between them;
+// when one runs out the count so far is returned with stats->gaveUp set.
+unsigned long long parallelCount (const Geometry&, const int[], int threads=0,
+                                  const Limits& = Limits(), SearchStats* = 0);
+unsigned long long parallelCount (const ConstraintGraph&, const int[], int threads=0,
+                                  const Limits& = Limits(), SearchStats* = 0);
+
+#endif // SOLVER_H
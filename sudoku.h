@@ -1,33 +1,31 @@
 #ifndef SUDOKU_H
 #define SUDOKU_H
+#include "solver.h"
 #include <vector>
 #include <set>
 
 typedef std::set<int> Node;
 typedef std::vector< Node > Grid;
-typedef std::vector< Node* > Group;
 
 class Sudoku
 {
 
 private:
     Grid grid;
+    ConstraintGraph units;
     int N,S,R,C,SR,SC,NSH,NSV;
     std::set<int> bad;
     std::set<int> given;
     int nsolutions;
+    Budget *budget; // limits of the call in progress, if any
+    SearchStats stats;
     
 private:
-    Group Row (int);
-    Group Column (int);
-    Group SubGrid (int);
-    
-private:
-    void GroupCheck (int,int);   
-    void RandomCheck (bool count=false);
-    bool generateGrid_private (int, Node*, std::vector<int>);
+    void board (int[]) const;
+    unsigned long long countSolutions (unsigned long long);
+    SearchStatus Solve_private (Budget&);
+    bool generateGrid_private (int, Node*, std::vector<int>, Grid&, int&);
     void findBadNodes_private (int[]);
-    bool Solve_private (bool count=false);
     
 public:
     bool Solve ();
@@ -37,13 +35,21 @@ public:
     const Node& GetNode (int,int) const;
     void generateGrid (int);
     const std::set<int>& badNodes () const;
+
+    // The same within limits. On GaveUp, Solve leaves the grid as it was,
+    // nSolutions gives the solutions found so far and generateGrid the
+    // grid with the most entries it managed to remove. When generateGrid
+    // can't remove that many (NotFound) it leaves the full grid, as
+    // without limits. lastStats tells what the last of these calls took.
+    SearchStatus Solve (const Limits&);
+    SearchStatus nSolutions (const Limits&, unsigned long long&);
+    SearchStatus generateGrid (int, const Limits&);
+    const SearchStats& lastStats () const;
     
 public:
     Sudoku(int,int,int,int,int[]);
     Sudoku(int,int,int,int);
-
-private:
-    Sudoku(int,int,int,int,Grid);
+    Sudoku(const ConstraintGraph&, int[]); // jigsaw, diagonal and other variants
 
 };
 
@@ -1,17 +1,19 @@
-#-------------------------------------------------
-#
-# Project created by QtCreator 2012-10-29T19:06:19
-#
-#-------------------------------------------------
-
-QT       += core gui
-
-TARGET = sudoku
-TEMPLATE = app
-
-SOURCES += main.cpp\
-        mainwindow.cpp \
-    sudoku.cpp
-
-HEADERS  += mainwindow.h \
-    sudoku.h
+#-------------------------------------------------
+#
+# Project created by QtCreator 2012-10-29T19:06:19
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = sudoku
+TEMPLATE = app
+
+include(core.pri)
+
+SOURCES += main.cpp\
+        mainwindow.cpp \
+    board.cpp
+
+HEADERS  += mainwindow.h \
+    board.h